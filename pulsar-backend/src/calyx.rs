@@ -3,6 +3,7 @@
 use super::PulsarBackend;
 use crate::Output;
 use calyx_backend::Backend;
+use calyx_ir::GetAttributes;
 use pulsar_calyx_builder::{
     build_assignments_2, finish_component, CalyxAssignmentContainer,
     CalyxBuilder, CalyxCell, CalyxCellKind, CalyxComponent, CalyxControl,
@@ -18,7 +19,14 @@ use pulsar_ir::{
     variable::Variable,
     Ir
 };
-use std::{io::stderr, path::PathBuf};
+use pulsar_utils::stats::Phases;
+use std::{
+    collections::{HashMap, HashSet},
+    fs,
+    io::stderr,
+    path::PathBuf,
+    str::FromStr
+};
 
 // This file contains many examples of BAD software engineering.
 // All components are treated very much like functions. They have input ports
@@ -28,14 +36,93 @@ use std::{io::stderr, path::PathBuf};
 // I realized that a contributing factor to this is that my IR has everything
 // has Int64. I should change that
 
+/// How many cycles the harness holds `reset` high for. The stateful cells
+/// this backend instantiates (`std_reg`, the pipelined multiplier, and the
+/// FSM registers calyx adds during lowering) should clear on the first edge,
+/// but no simulation has shown that a design accepts `go` that soon, so this
+/// keeps the reset the harness has always used.
+const RESET_CYCLES: usize = 10;
+
+/// Which calyx passes lower the built program to Verilog.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum CalyxPasses {
+    /// Only the passes that lowering requires (calyx's `no-opt`), for test
+    /// builds that are compiled far more often than they are run. Nothing is
+    /// scheduled statically, so the harness waits on `done` for every
+    /// invocation.
+    Fast,
+
+    /// Every pass of calyx's default pipeline, including static inference
+    /// and promotion, inlining, and cell sharing.
+    #[default]
+    Full
+}
+
+impl CalyxPasses {
+    /// The pass aliases to execute, in order.
+    fn plan(self) -> &'static [&'static str] {
+        match self {
+            Self::Fast => &["no-opt"],
+            // the same passes as `all`, split so that the static latency can
+            // be read before `compile` lowers static control away
+            Self::Full => {
+                &["validate", "pre-opt", "compile", "post-opt", "lower"]
+            }
+        }
+    }
+}
+
+impl FromStr for CalyxPasses {
+    type Err = String;
+
+    fn from_str(name: &str) -> Result<Self, Self::Err> {
+        match name {
+            "fast" => Ok(Self::Fast),
+            "full" => Ok(Self::Full),
+            _ => Err(format!(
+                "Unknown pass set '{}', expected 'fast' or 'full'",
+                name
+            ))
+        }
+    }
+}
+
 #[derive(Default)]
 struct FunctionContext {
     ret_cell: Option<CalyxCell>,
-    param_env: usize
+    param_env: usize,
+    params: Vec<Type>,
+    is_main: bool,
+    /// The array `main` returns, which is allocated as the memory `ret`
+    /// instead of under its variable's name.
+    ret_array: Option<Variable>
+}
+
+/// A memory on the top-level component that the harness can read and write
+/// directly.
+struct TopMemory {
+    cell_name: String,
+    length: usize,
+    width: usize
+}
+
+/// A port on the top-level component other than the calyx control ports.
+struct TopPort {
+    name: String,
+    width: u64,
+    direction: &'static str
 }
 
 pub struct CalyxBackend {
-    builder: CalyxBuilder
+    builder: CalyxBuilder,
+    manifest: Option<PathBuf>,
+    passes: CalyxPasses,
+    dump: bool,
+    top_name: String,
+    /// The indices of the scalar `arg<i>` ports on the top-level component.
+    top_ports: Vec<usize>,
+    top_port_defs: Vec<TopPort>,
+    top_memories: Vec<TopMemory>
 }
 
 impl CalyxBackend {
@@ -49,6 +136,21 @@ impl CalyxBackend {
         component.named_mem(var.to_string(), cell_size, length, 64)
     }
 
+    /// A memory on `main` named `name` in place of a port, so that the
+    /// harness can load or read the entire array at once.
+    fn make_top_memory(
+        &mut self, component: &mut CalyxComponent<FunctionContext>,
+        name: String, cell_size: usize, length: usize
+    ) -> CalyxCell {
+        let cell = component.named_mem(name, cell_size, length, 64);
+        self.top_memories.push(TopMemory {
+            cell_name: cell.value.borrow().name().to_string(),
+            length,
+            width: cell_size
+        });
+        cell
+    }
+
     /// Builds a constant if the operand is a constant and looks up a variable
     /// otherwise.
     fn find_operand_cell(
@@ -62,21 +164,41 @@ impl CalyxBackend {
     }
 
     fn register_func(&mut self, label: &Label, args: &[Type], ret: &Type) {
+        let is_main = label.name.mangle().starts_with(MAIN_SYMBOL_PREFIX);
         let mut comp_ports = vec![];
         for (i, arg) in args.iter().enumerate() {
-            let width = arg.size();
+            if is_main && arg.is_array() {
+                continue;
+            }
+            let width = (arg.size() * 8) as u64;
             let name = format!("arg{}", i);
+            if is_main {
+                self.top_ports.push(i);
+                self.top_port_defs.push(TopPort {
+                    name: name.clone(),
+                    width,
+                    direction: "input"
+                });
+            }
             comp_ports.push(calyx_ir::PortDef::new(
                 name,
-                (width * 8) as u64,
+                width,
                 calyx_ir::Direction::Input,
                 calyx_ir::Attributes::default()
             ));
         }
-        if *ret != Type::Unit {
+        if *ret != Type::Unit && !(is_main && ret.is_array()) {
+            let width = (ret.size() * 8) as u64;
+            if is_main {
+                self.top_port_defs.push(TopPort {
+                    name: "ret".into(),
+                    width,
+                    direction: "output"
+                });
+            }
             comp_ports.push(calyx_ir::PortDef::new(
                 "ret",
-                (ret.size() * 8) as u64,
+                width,
                 calyx_ir::Direction::Output,
                 calyx_ir::Attributes::default()
             ));
@@ -84,7 +206,8 @@ impl CalyxBackend {
         self.builder
             .register_component(label.name.mangle().clone(), comp_ports);
 
-        if label.name.mangle().starts_with(MAIN_SYMBOL_PREFIX) {
+        if is_main {
+            self.top_name = label.name.mangle().clone();
             self.builder.set_entrypoint(label.name.mangle().clone());
         }
     }
@@ -109,7 +232,7 @@ impl CalyxBackend {
     }
 
     fn emit_ir(
-        &self, component: &mut CalyxComponent<FunctionContext>,
+        &mut self, component: &mut CalyxComponent<FunctionContext>,
         parent: &mut CalyxControl<Sequential>, ir: &Ir
     ) {
         let signal_out = component.signal_out();
@@ -163,6 +286,21 @@ impl CalyxBackend {
                 parent.enable_next(&assign_group);
             }
             Ir::GetParam(result) => {
+                let param_index = component.user_data_ref().param_env;
+                let param =
+                    component.user_data_ref().params[param_index].clone();
+                if component.user_data_ref().is_main && param.is_array() {
+                    let (element_type, length) = param.as_array_type();
+                    let memory = self.make_top_memory(
+                        component,
+                        format!("arg{}", param_index),
+                        element_type.as_ref().size() * 8,
+                        length as usize
+                    );
+                    component.alias_cell(result.to_string(), memory);
+                    component.user_data_mut().param_env += 1;
+                    return;
+                }
                 let func = component.signature();
                 // TODO: memory refs
                 let result_cell = component.new_reg(result.to_string(), 64);
@@ -182,6 +320,10 @@ impl CalyxBackend {
                 // returns, this requires structured IR anyways so doesn't
                 // matter right now
                 if let Some(value) = value_opt {
+                    if component.user_data_ref().ret_array.is_some() {
+                        // already written in place to the `ret` memory
+                        return;
+                    }
                     let return_group = component.add_group("return");
                     let mut value_cell =
                         self.find_operand_cell(component, value);
@@ -214,6 +356,16 @@ impl CalyxBackend {
                 }
             }
             Ir::LocalAlloc(result, size, count) => {
+                if component.user_data_ref().ret_array == Some(*result) {
+                    let memory = self.make_top_memory(
+                        component,
+                        "ret".into(),
+                        *size * 8,
+                        *count
+                    );
+                    component.alias_cell(result.to_string(), memory);
+                    return;
+                }
                 self.make_cell_for_array(component, *result, *size * 8, *count);
             }
             Ir::Store {
@@ -367,7 +519,7 @@ impl CalyxBackend {
     }
 
     fn emit_block(
-        &self, component: &mut CalyxComponent<FunctionContext>,
+        &mut self, component: &mut CalyxComponent<FunctionContext>,
         parent: &mut CalyxControl<Sequential>, block: BasicBlockCell
     ) {
         parent.seq(|s| {
@@ -377,14 +529,52 @@ impl CalyxBackend {
         });
     }
 
+    /// The array allocation that `block` eventually returns, if any, found by
+    /// following the copies of its returned variable back to a
+    /// [`Ir::LocalAlloc`].
+    fn find_returned_array(block: &BasicBlockCell) -> Option<Variable> {
+        let mut returned = None;
+        let mut copies = HashMap::new();
+        let mut allocs = HashSet::new();
+        for ir in block.as_ref().into_iter() {
+            match ir {
+                Ir::Assign(result, Operand::Variable(value)) => {
+                    copies.insert(*result, *value);
+                }
+                Ir::LocalAlloc(result, _, _) => {
+                    allocs.insert(*result);
+                }
+                Ir::Return(Some(Operand::Variable(value))) => {
+                    returned = Some(*value);
+                }
+                _ => {}
+            }
+        }
+        let mut var = returned?;
+        while let Some(source) = copies.get(&var) {
+            var = *source;
+        }
+        assert!(
+            allocs.contains(&var),
+            "main can only return an array it allocates itself"
+        );
+        Some(var)
+    }
+
     fn emit_func(
-        &mut self, label: &Label, _args: &[Type], ret: &Type, _is_pure: bool,
+        &mut self, label: &Label, args: &[Type], ret: &Type, _is_pure: bool,
         cfg: &ControlFlowGraph
     ) {
         let mut component: CalyxComponent<FunctionContext> =
             self.builder.start_component(label.name.mangle().clone());
-
-        if *ret != Type::Unit {
+        let is_main = label.name.mangle().starts_with(MAIN_SYMBOL_PREFIX);
+        component.user_data_mut().params = args.to_vec();
+        component.user_data_mut().is_main = is_main;
+
+        if is_main && ret.is_array() {
+            component.user_data_mut().ret_array =
+                Self::find_returned_array(&cfg.entry());
+        } else if *ret != Type::Unit {
             let func = component.signature();
             let ret_cell =
                 component.new_unnamed_cell(CalyxCellKind::Register {
@@ -410,10 +600,189 @@ impl CalyxBackend {
 
         finish_component!(self.builder, component);
     }
+
+    /// Builds a calyx program from `code`, lowers it with the passes this
+    /// backend was constructed with, and writes the resulting Verilog to
+    /// `output` directly. Building, each pass alias, and writing the Verilog
+    /// are recorded in `phases`.
+    pub fn emit(
+        mut self, code: Vec<GeneratedTopLevel>, output: Output,
+        phases: &mut Phases
+    ) -> Result<(), calyx_utils::Error> {
+        // Create a calyx program from the IR
+        let mut calyx_ctx = phases.measure("build", || {
+            // - Step 1: load signatures
+            for generated_top_level in &code {
+                match generated_top_level {
+                    GeneratedTopLevel::Function {
+                        label,
+                        args,
+                        ret,
+                        is_pure: _,
+                        cfg: _
+                    } => {
+                        self.register_func(label, args, ret);
+                    }
+                }
+            }
+            // - Step 2: emit generated IR
+            for generated_top_level in &code {
+                match generated_top_level {
+                    GeneratedTopLevel::Function {
+                        label,
+                        args,
+                        ret,
+                        is_pure,
+                        cfg
+                    } => self.emit_func(label, args, ret, *is_pure, cfg)
+                }
+            }
+
+            // Obtain the program context
+            let mut builder = CalyxBuilder::dummy();
+            std::mem::swap(&mut builder, &mut self.builder);
+            builder.finalize()
+        });
+
+        if self.dump {
+            calyx_ir::Printer::write_context(&calyx_ctx, false, &mut stderr())
+                .unwrap();
+        }
+
+        // Perform optimization passes
+        let pm = calyx_opt::pass_manager::PassManager::default_passes()?;
+        let backend_conf = calyx_ir::BackendConf {
+            synthesis_mode: false,
+            enable_verification: false,
+            flat_assign: true,
+            emit_primitive_extmodules: false
+        };
+        calyx_ctx.bc = backend_conf;
+        let mut static_latency = None;
+        for pass in self.passes.plan() {
+            phases.measure(pass, || {
+                pm.execute_plan(
+                    &mut calyx_ctx,
+                    &[pass.to_string()],
+                    &["canonicalize".to_string()],
+                    false
+                )
+            })?;
+            if *pass == "pre-opt" {
+                static_latency = Self::static_latency(&calyx_ctx);
+            }
+        }
+
+        // Emit to Verilog
+        phases.measure("verilog", || {
+            let backend = calyx_backend::VerilogBackend;
+            backend.run(calyx_ctx, output.into())
+        })?;
+        self.write_manifest(static_latency)
+    }
+
+    /// The number of cycles the entry component of `ctx` takes to run when
+    /// calyx has made it a static component, which the harness clocks for
+    /// instead of waiting on `done`. This is only known once `pre-opt` has
+    /// inferred latencies and promoted what it could. A `@promotable` hint on
+    /// control that was not promoted is not a latency: the component stays
+    /// dynamic and its FSM adds cycles of its own.
+    fn static_latency(ctx: &calyx_ir::Context) -> Option<u64> {
+        let main = ctx
+            .components
+            .iter()
+            .find(|component| component.name == ctx.entrypoint)?;
+        main.latency.map(|latency| latency.get())
+    }
+
+    /// Writes the interface of the top-level component as JSON to the
+    /// manifest path and as preprocessor definitions for the harness to a
+    /// header next to it, so that neither has to be scraped from the Verilog.
+    fn write_manifest(
+        &self, static_latency: Option<u64>
+    ) -> Result<(), calyx_utils::Error> {
+        let Some(path) = &self.manifest else {
+            return Ok(());
+        };
+
+        let ports = self
+            .top_port_defs
+            .iter()
+            .map(|port| {
+                format!(
+                    "{{\"name\": \"{}\", \"width\": {}, \"direction\": \"{}\"}}",
+                    port.name, port.width, port.direction
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(", ");
+        let memories = self
+            .top_memories
+            .iter()
+            .map(|memory| {
+                format!(
+                    "{{\"name\": \"{}\", \"length\": {}, \"width\": {}}}",
+                    memory.cell_name, memory.length, memory.width
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(", ");
+        let json = format!(
+            "{{\"top\": \"{}\", \"reset_cycles\": {}, \"ports\": [{}], \"memories\": [{}], \"static_latency\": {}}}\n",
+            self.top_name,
+            RESET_CYCLES,
+            ports,
+            memories,
+            static_latency.map_or("null".into(), |latency| latency.to_string())
+        );
+
+        let mut header = String::from("// Generated by pulsar. Do not edit.\n");
+        let mut define = |name: &str, value: String| {
+            header.push_str(&format!(
+                "#ifndef {0}\n    #define {0} {1}\n#endif\n",
+                name, value
+            ));
+        };
+        define("PULSAR_TOP_MODULE", format!("\"{}\"", self.top_name));
+        define("PULSAR_RESET_CYCLES", RESET_CYCLES.to_string());
+        define(
+            "PULSAR_PORTS",
+            self.top_ports
+                .iter()
+                .map(|port| port.to_string())
+                .collect::<Vec<_>>()
+                .join(", ")
+        );
+        define("PULSAR_MEMORIES", self.top_memories.len().to_string());
+        for memory in &self.top_memories {
+            let name = memory.cell_name.trim_start_matches('_');
+            define(
+                &format!("PULSAR_MEMORY_LENGTH_{}", name),
+                memory.length.to_string()
+            );
+            define(
+                &format!("PULSAR_MEMORY_WIDTH_{}", name),
+                memory.width.to_string()
+            );
+        }
+        if let Some(latency) = static_latency {
+            define("PULSAR_STATIC_LATENCY", latency.to_string());
+        }
+
+        fs::write(path, json)
+            .and_then(|()| fs::write(path.with_extension("h"), header))
+            .map_err(|err| calyx_utils::Error::misc(err.to_string()))
+    }
 }
 
 pub struct CalyxBackendInput {
-    pub lib_path: PathBuf
+    pub lib_path: PathBuf,
+    /// Where to write the interface manifest of the top-level component, if
+    /// anywhere. A C header with the same contents is written next to it.
+    pub manifest: Option<PathBuf>,
+    pub passes: CalyxPasses,
+    /// Whether to print the calyx program to stderr before any pass runs.
+    pub dump: bool
 }
 
 impl PulsarBackend for CalyxBackend {
@@ -432,70 +801,21 @@ impl PulsarBackend for CalyxBackend {
                 None,
                 "_".into()
             )
-            .expect("Invalid library path")
+            .expect("Invalid library path"),
+            manifest: input.manifest,
+            passes: input.passes,
+            dump: input.dump,
+            top_name: String::new(),
+            top_ports: vec![],
+            top_port_defs: vec![],
+            top_memories: vec![]
         }
     }
 
     fn run(
-        mut self, code: Vec<GeneratedTopLevel>, output: Output
+        self, code: Vec<GeneratedTopLevel>, output: Output
     ) -> Result<(), Self::Error> {
-        // Create a calyx program from the IR
-        // - Step 1: load signatures
-        for generated_top_level in &code {
-            match generated_top_level {
-                GeneratedTopLevel::Function {
-                    label,
-                    args,
-                    ret,
-                    is_pure: _,
-                    cfg: _
-                } => {
-                    self.register_func(label, args, ret);
-                }
-            }
-        }
-        // - Step 2: emit generated IR
-        for generated_top_level in &code {
-            match generated_top_level {
-                GeneratedTopLevel::Function {
-                    label,
-                    args,
-                    ret,
-                    is_pure,
-                    cfg
-                } => self.emit_func(label, args, ret, *is_pure, cfg)
-            }
-        }
-
-        // Obtain the program context
-        let mut builder = CalyxBuilder::dummy();
-        std::mem::swap(&mut builder, &mut self.builder);
-        let mut calyx_ctx = builder.finalize();
-
-        // Debug print
-        calyx_ir::Printer::write_context(&calyx_ctx, false, &mut stderr())
-            .unwrap();
-
-        // Perform optimization passes
-        let pm = calyx_opt::pass_manager::PassManager::default_passes()?;
-        let backend_conf = calyx_ir::BackendConf {
-            synthesis_mode: false,
-            enable_verification: false,
-            flat_assign: true,
-            emit_primitive_extmodules: false
-        };
-        calyx_ctx.bc = backend_conf;
-        pm.execute_plan(
-            &mut calyx_ctx,
-            &["all".to_string()],
-            &["canonicalize".to_string()],
-            false
-        )?;
-
-        // Emit to Verilog
-        let backend = calyx_backend::VerilogBackend;
-        backend.run(calyx_ctx, output.into())?;
-        Ok(())
+        self.emit(code, output, &mut Phases::new())
     }
 }
 
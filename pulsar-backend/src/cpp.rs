@@ -0,0 +1,459 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+
+use super::PulsarBackend;
+use crate::Output;
+use pulsar_frontend::ty::Type;
+use pulsar_ir::{
+    control_flow_graph::ControlFlowGraph,
+    generator::GeneratedTopLevel,
+    label::{LabelName, MAIN_SYMBOL_PREFIX},
+    operand::Operand,
+    variable::Variable,
+    Ir
+};
+use pulsar_utils::error::{
+    ErrorBuilder, ErrorCode, ErrorManager, Level, Style
+};
+use std::{
+    cell::RefCell,
+    collections::{HashMap, HashSet},
+    fmt::Write as _,
+    fs,
+    io::{self, stderr, stdout, Write},
+    rc::Rc
+};
+
+// The C++ this emits is a golden model for the hardware the calyx backend
+// builds from the same IR, so it follows the hardware where C++ would differ:
+// arithmetic wraps at 64 bits, and a function returning an array writes it to
+// storage its caller passes as a trailing `ret`, just as `main` writes the
+// `ret` memory. `map` is always a sequential loop whatever its factor.
+//
+// Only what the calyx backend can also lower is modeled: a single basic block
+// per function over arrays of `Int`. Any other program is still a valid one,
+// so rather than emitting a model of it this warns that it was skipped.
+
+const PRELUDE: &str = "\
+// Generated by pulsar from the same IR as the hardware. Do not edit.
+#include <cstddef>
+#include <cstdint>
+
+namespace pulsar_reference {
+static inline int64_t add(int64_t lhs, int64_t rhs) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(lhs) + static_cast<uint64_t>(rhs));
+}
+
+static inline int64_t mul(int64_t lhs, int64_t rhs) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(lhs) * static_cast<uint64_t>(rhs));
+}
+";
+
+/// The signature of a generated function.
+struct Signature {
+    args: Vec<Type>,
+    ret: Type
+}
+
+/// Why a program has no reference model.
+type Unsupported = String;
+
+/// The number of `int64_t` words an array of type `ty` occupies.
+fn words(ty: &Type) -> Result<usize, Unsupported> {
+    let (element_type, _) = ty.as_array_type();
+    if element_type.as_ref().size() != 8 {
+        return Err(format!("`{}` is not an array of `Int`", ty));
+    }
+    Ok(ty.size() / 8)
+}
+
+fn operand(value: &Operand) -> String {
+    match value {
+        Operand::Constant(value) => value.to_string(),
+        Operand::Variable(var) => var.to_string()
+    }
+}
+
+pub struct CppBackend {
+    error_manager: Rc<RefCell<ErrorManager>>,
+    signatures: HashMap<String, Signature>,
+    out: String
+}
+
+impl CppBackend {
+    /// The declaration of the function `name`, whose parameters are named
+    /// `names` or otherwise `arg<i>`.
+    fn declaration(
+        &self, name: &str, signature: &Signature, names: &[String]
+    ) -> String {
+        let mut params = signature
+            .args
+            .iter()
+            .enumerate()
+            .map(|(i, arg)| {
+                let name = names
+                    .get(i)
+                    .cloned()
+                    .unwrap_or_else(|| format!("arg{}", i));
+                if arg.is_array() {
+                    format!("const int64_t* {}", name)
+                } else {
+                    format!("int64_t {}", name)
+                }
+            })
+            .collect::<Vec<_>>();
+        let ret = match signature.ret {
+            Type::Unit => "void",
+            Type::Array(_, _) => {
+                params.push("int64_t* ret".into());
+                "void"
+            }
+            _ => "int64_t"
+        };
+        format!("static inline {} {}({})", ret, name, params.join(", "))
+    }
+
+    fn signature(&self, name: &LabelName) -> Result<&Signature, Unsupported> {
+        self.signatures.get(name.mangle()).ok_or_else(|| {
+            format!("`{}` is called but not defined in the program", name)
+        })
+    }
+
+    /// The C++ statement for `ir`, or `None` for a parameter, which is named
+    /// after its variable in the function's declaration instead.
+    fn emit_ir(
+        &self, ir: &Ir, signature: &Signature, params: &mut usize,
+        arrays: &mut HashSet<Variable>
+    ) -> Result<Option<String>, Unsupported> {
+        let line = match ir {
+            Ir::Add(result, lhs, rhs) => format!(
+                "const int64_t {} = add({}, {});",
+                result,
+                operand(lhs),
+                operand(rhs)
+            ),
+            Ir::Mul(result, lhs, rhs) => format!(
+                "const int64_t {} = mul({}, {});",
+                result,
+                operand(lhs),
+                operand(rhs)
+            ),
+            Ir::Assign(result, value) => match value {
+                Operand::Variable(var) if arrays.contains(var) => {
+                    arrays.insert(*result);
+                    format!("const int64_t* {} = {};", result, var)
+                }
+                _ => format!("const int64_t {} = {};", result, operand(value))
+            },
+            Ir::GetParam(result) => {
+                if signature.args[*params].is_array() {
+                    arrays.insert(*result);
+                }
+                *params += 1;
+                return Ok(None);
+            }
+            Ir::Return(None) => "return;".into(),
+            Ir::Return(Some(value)) if signature.ret.is_array() => format!(
+                "for (size_t j = 0; j < {}; j++) {{\n        ret[j] = \
+                 {}[j];\n    }}\n    return;",
+                words(&signature.ret)?,
+                operand(value)
+            ),
+            Ir::Return(Some(value)) => format!("return {};", operand(value)),
+            Ir::LocalAlloc(result, size, count) => {
+                if *size != 8 {
+                    return Err(format!(
+                        "`{}` allocates elements of {} bytes rather than `Int`",
+                        result, size
+                    ));
+                }
+                arrays.insert(*result);
+                format!("int64_t {}[{}] = {{}};", result, count)
+            }
+            Ir::Store {
+                result,
+                value,
+                index
+            } => format!("{}[{}] = {};", result, operand(index), operand(value)),
+            Ir::Load {
+                result,
+                value,
+                index
+            } => format!(
+                "const int64_t {} = {}[{}];",
+                result,
+                operand(value),
+                operand(index)
+            ),
+            Ir::Map {
+                result,
+                parallel_factor: _,
+                f,
+                input,
+                length
+            } => {
+                self.signature(f)?;
+                format!(
+                    "for (size_t j = 0; j < {}; j++) {{\n        {}[j] = \
+                     {}({}[j]);\n    }}",
+                    length,
+                    result,
+                    f.mangle(),
+                    operand(input)
+                )
+            }
+            Ir::Call(result_opt, f, args) => {
+                let mut args = args.iter().map(operand).collect::<Vec<_>>();
+                let callee_ret = &self.signature(f)?.ret;
+                match (result_opt, callee_ret) {
+                    (Some(result), Type::Array(_, _)) => {
+                        arrays.insert(*result);
+                        args.push(result.to_string());
+                        format!(
+                            "int64_t {}[{}] = {{}};\n    {}({});",
+                            result,
+                            words(callee_ret)?,
+                            f.mangle(),
+                            args.join(", ")
+                        )
+                    }
+                    (Some(result), _) => format!(
+                        "const int64_t {} = {}({});",
+                        result,
+                        f.mangle(),
+                        args.join(", ")
+                    ),
+                    (None, _) => format!("{}({});", f.mangle(), args.join(", "))
+                }
+            }
+        };
+        Ok(Some(line))
+    }
+
+    fn emit_func(
+        &mut self, name: &str, cfg: &ControlFlowGraph
+    ) -> Result<(), Unsupported> {
+        if cfg.size() != 1 {
+            return Err(format!(
+                "`{}` has {} basic blocks rather than one",
+                name,
+                cfg.size()
+            ));
+        }
+        let signature = &self.signatures[name];
+        let mut names = vec![];
+        let mut body = String::new();
+        let mut params = 0;
+        let mut arrays = HashSet::new();
+        for ir in cfg.entry().as_ref().into_iter() {
+            match self.emit_ir(ir, signature, &mut params, &mut arrays)? {
+                Some(line) => {
+                    let _ = writeln!(body, "    {}", line);
+                }
+                None => {
+                    if let Ir::GetParam(result) = ir {
+                        names.push(result.to_string());
+                    }
+                }
+            }
+        }
+        let _ = write!(
+            self.out,
+            "\n{} {{\n{}}}\n",
+            self.declaration(name, signature, &names),
+            body
+        );
+        Ok(())
+    }
+
+    /// Emits `top`, which forwards to `main` under a name that does not
+    /// depend on its signature, and a `main` function that runs it once
+    /// standalone when compiled with `PULSAR_REFERENCE_MAIN`.
+    fn emit_top(&mut self, name: &str) -> Result<(), Unsupported> {
+        let signature = &self.signatures[name];
+        let mut args = (0..signature.args.len())
+            .map(|i| format!("arg{}", i))
+            .collect::<Vec<_>>();
+        if signature.ret.is_array() {
+            args.push("ret".into());
+        }
+        let mut out = String::new();
+        let _ =
+            writeln!(out, "\n{} {{", self.declaration("top", signature, &[]));
+        let _ = writeln!(out, "    return {}({});", name, args.join(", "));
+        out.push_str("}\n}\n");
+
+        // scalar arguments come from the command line and arrays from
+        // standard input, and each word of the result is printed on a line
+        let usage = (0..signature.args.len())
+            .filter(|i| !signature.args[*i].is_array())
+            .map(|i| format!(" <arg{}>", i))
+            .collect::<String>();
+        out.push_str(
+            "\n#ifdef PULSAR_REFERENCE_MAIN\n    #include <cstdlib>\n    \
+             #include <iostream>\n\nint main(int argc, char** argv) {\n"
+        );
+        let _ = writeln!(
+            out,
+            "    if (argc != {}) {{\n        std::cerr << \"usage: \" << \
+             argv[0] << \"{}\\n\";\n        return 1;\n    }}",
+            usage.matches('<').count() + 1,
+            usage
+        );
+        let mut argv_index = 1;
+        for (i, arg) in signature.args.iter().enumerate() {
+            if arg.is_array() {
+                let n = words(arg)?;
+                let _ = writeln!(out, "    int64_t arg{}[{}] = {{}};", i, n);
+                let _ = writeln!(
+                    out,
+                    "    for (size_t j = 0; j < {}; j++) {{\n        if \
+                     (!(std::cin >> arg{}[j])) {{\n            std::cerr << \
+                     \"reference: expected {} values of arg{} on standard \
+                     input\"\n                      << '\\n';\n            \
+                     return 1;\n        }}\n    }}",
+                    n, i, n, i
+                );
+            } else {
+                let _ = writeln!(
+                    out,
+                    "    const int64_t arg{} = std::strtoll(argv[{}], \
+                     nullptr, 0);",
+                    i, argv_index
+                );
+                argv_index += 1;
+            }
+        }
+        let call = format!("pulsar_reference::top({})", args.join(", "));
+        match &signature.ret {
+            Type::Array(_, _) => {
+                let n = words(&signature.ret)?;
+                let _ = writeln!(out, "    int64_t ret[{}] = {{}};", n);
+                let _ = writeln!(out, "    {};", call);
+                let _ = writeln!(
+                    out,
+                    "    for (size_t j = 0; j < {}; j++) {{\n        \
+                     std::cout << ret[j] << '\\n';\n    }}",
+                    n
+                );
+            }
+            Type::Unit => {
+                let _ = writeln!(out, "    {};", call);
+            }
+            _ => {
+                let _ = writeln!(out, "    std::cout << {} << '\\n';", call);
+            }
+        }
+        out.push_str("    return 0;\n}\n#endif\n");
+        self.out.push_str(&out);
+        Ok(())
+    }
+
+    /// The C++ reference model of `code`.
+    fn model(&mut self, code: &[GeneratedTopLevel]) -> Result<(), Unsupported> {
+        self.out.push_str(PRELUDE);
+        // every function is declared up front so that they can call each
+        // other in any order
+        self.out.push('\n');
+        let mut main = None;
+        for generated_top_level in code {
+            match generated_top_level {
+                GeneratedTopLevel::Function {
+                    label,
+                    args,
+                    ret,
+                    is_pure: _,
+                    cfg: _
+                } => {
+                    let name = label.name.mangle();
+                    let signature = Signature {
+                        args: args.clone(),
+                        ret: ret.as_ref().clone()
+                    };
+                    let _ = writeln!(
+                        self.out,
+                        "{};",
+                        self.declaration(name, &signature, &[])
+                    );
+                    self.signatures.insert(name.clone(), signature);
+                    if name.starts_with(MAIN_SYMBOL_PREFIX) {
+                        main = Some(name.clone());
+                    }
+                }
+            }
+        }
+        for generated_top_level in code {
+            match generated_top_level {
+                GeneratedTopLevel::Function {
+                    label,
+                    args: _,
+                    ret: _,
+                    is_pure: _,
+                    cfg
+                } => self.emit_func(label.name.mangle(), cfg)?
+            }
+        }
+        match main {
+            Some(main) => self.emit_top(&main)?,
+            None => self.out.push_str("}\n")
+        }
+        Ok(())
+    }
+
+    /// Writes the C++ reference model of `code` to `output`. Unlike
+    /// [`PulsarBackend::run`], this leaves `code` to be lowered to hardware
+    /// afterward. A program that cannot be modeled is not an error: a warning
+    /// is recorded instead and nothing is written, removing any model left in
+    /// a file `output` from before.
+    pub fn emit(
+        mut self, code: &[GeneratedTopLevel], output: Output
+    ) -> io::Result<()> {
+        if let Err(reason) = self.model(code) {
+            let model = match &output {
+                Output::File(path) => {
+                    format!("reference model `{}`", path.display())
+                }
+                _ => "reference model".into()
+            };
+            self.error_manager.borrow_mut().record(
+                ErrorBuilder::new()
+                    .of_style(Style::Primary)
+                    .at_level(Level::Warning)
+                    .with_code(ErrorCode::UnsupportedByBackend)
+                    .without_loc()
+                    .message(format!("Skipped the {}, since {}", model, reason))
+                    .build()
+            );
+            return match output {
+                Output::File(path) if path.exists() => fs::remove_file(path),
+                _ => Ok(())
+            };
+        }
+
+        match output {
+            Output::Stdout => stdout().write_all(self.out.as_bytes()),
+            Output::Stderr => stderr().write_all(self.out.as_bytes()),
+            Output::File(path) => fs::write(path, self.out)
+        }
+    }
+}
+
+impl PulsarBackend for CppBackend {
+    type InitInput = Rc<RefCell<ErrorManager>>;
+    type Error = io::Error;
+
+    fn new(input: Self::InitInput) -> Self {
+        Self {
+            error_manager: input,
+            signatures: HashMap::new(),
+            out: String::new()
+        }
+    }
+
+    fn run(
+        self, code: Vec<GeneratedTopLevel>, output: Output
+    ) -> Result<(), Self::Error> {
+        self.emit(&code, output)
+    }
+}
@@ -1,6 +1,8 @@
 //! The pulsar backend is currently under construction. The goal is for a
 //! modular but expressive (in e.g. output file location) interface. A
 //! [`calyx_backend::CalyxBackend`] is under construction.
+//! [`cpp::CppBackend`] emits a C++ model of the same IR that the harness
+//! checks the hardware against.
 //!
 //! Copyright (C) 2024 Ethan Uppal. All rights reserved.
 
@@ -8,9 +10,11 @@ use pulsar_ir::generator::GeneratedTopLevel;
 use std::path::PathBuf;
 
 pub mod calyx;
+pub mod cpp;
 
 // This interface hasn't been finalized yet, so it is quite sloppy as written
 
+#[derive(Clone)]
 pub enum Output {
     Stdout,
     Stderr,
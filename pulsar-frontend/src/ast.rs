@@ -11,7 +11,10 @@ use pulsar_utils::{
     format,
     loc::{Loc, RegionProvider}
 };
-use std::fmt::{self, Display};
+use std::{
+    collections::BTreeSet,
+    fmt::{self, Display}
+};
 
 pub type Param = (Token, Type);
 
@@ -87,6 +90,38 @@ impl Expr {
             ty: TypeCell::new(Type::Unknown)
         }
     }
+
+    /// Adds every name that this expression refers to to `names`.
+    fn collect_names<'a>(&'a self, names: &mut BTreeSet<&'a str>) {
+        match &self.value {
+            ExprValue::ConstantInt(_) => {}
+            ExprValue::BoundName(name) => {
+                names.insert(&name.value);
+            }
+            ExprValue::MemberAccess(value, _) => value.collect_names(names),
+            ExprValue::Call(name, args) => {
+                names.insert(&name.value);
+                for arg in args {
+                    arg.collect_names(names);
+                }
+            }
+            ExprValue::ArrayLiteral(elements, _) => {
+                for element in elements {
+                    element.collect_names(names);
+                }
+            }
+            ExprValue::PrefixOp(_, rhs) => rhs.collect_names(names),
+            ExprValue::InfixBop(lhs, _, rhs)
+            | ExprValue::PostfixBop(lhs, _, rhs, _) => {
+                lhs.collect_names(names);
+                rhs.collect_names(names);
+            }
+            ExprValue::HardwareMap(_, _, f, arr) => {
+                names.insert(&f.value);
+                arr.collect_names(names);
+            }
+        }
+    }
 }
 
 impl Display for Expr {
@@ -215,6 +250,65 @@ impl Node {
         self
     }
 
+    /// The name of this function and its type as its callers see it, or
+    /// `None` if this node is not a function.
+    pub fn signature(&self) -> Option<(String, Type)> {
+        match &self.value {
+            NodeValue::Function {
+                name,
+                params,
+                ret,
+                pure_token,
+                body: _
+            } => Some((
+                name.value.to_string(),
+                Type::Function {
+                    is_pure: pure_token.is_some(),
+                    args: params.iter().map(|(_, ty)| ty.clone()).collect(),
+                    ret: Box::new(ret.clone())
+                }
+            )),
+            _ => None
+        }
+    }
+
+    /// Every name that this node refers to, which includes the names of the
+    /// functions it calls.
+    pub fn names(&self) -> BTreeSet<&str> {
+        let mut names = BTreeSet::new();
+        self.collect_names(&mut names);
+        names
+    }
+
+    fn collect_names<'a>(&'a self, names: &mut BTreeSet<&'a str>) {
+        match &self.value {
+            NodeValue::Function {
+                name: _,
+                params: _,
+                ret: _,
+                pure_token: _,
+                body
+            } => {
+                for node in body {
+                    node.collect_names(names);
+                }
+            }
+            NodeValue::LetBinding {
+                name: _,
+                hint: _,
+                value
+            } => value.collect_names(names),
+            NodeValue::Return {
+                keyword_token: _,
+                value
+            } => {
+                if let Some(value) = value {
+                    value.collect_names(names);
+                }
+            }
+        }
+    }
+
     /// Pretty-prints this node at the given indentation `level`.
     fn pretty(&self, level: usize) -> String {
         let mut result = format::make_indent(level);
@@ -2,15 +2,16 @@
 use super::token::{Token, TokenType};
 use pulsar_utils::{
     error::{ErrorBuilder, ErrorCode, ErrorManager, Level, Style},
+    intern::Interner,
     loc::{Loc, Region, Source}
 };
-use std::{cell::RefCell, rc::Rc};
+use std::{cell::RefCell, rc::Rc, sync::Arc};
 
 /// Produces tokens from an input source.
 ///
 /// # Example
 /// ```
-/// fn lex(source: Rc<Source>, error_manager: Rc<RefCell<ErrorManager>>) {
+/// fn lex(source: Arc<Source>, error_manager: Rc<RefCell<ErrorManager>>) {
 ///     let lexer = Lexer::new(source, error_manager);
 ///     for token in lexer {
 ///         println! {"{}", token};
@@ -20,6 +21,9 @@ use std::{cell::RefCell, rc::Rc};
 pub struct Lexer {
     loc: Loc,
     buffer: Vec<char>,
+    interner: Interner,
+    /// Reused to build the text of each token before it is interned.
+    scratch: String,
     error_manager: Rc<RefCell<ErrorManager>>
 }
 
@@ -40,7 +44,7 @@ macro_rules! with_unwind {
 impl Lexer {
     /// Constructs a lexer for the given `source`.
     pub fn new(
-        source: Rc<Source>, error_manager: Rc<RefCell<ErrorManager>>
+        source: Arc<Source>, error_manager: Rc<RefCell<ErrorManager>>
     ) -> Self {
         Lexer {
             loc: Loc {
@@ -50,6 +54,8 @@ impl Lexer {
                 source: source.clone()
             },
             buffer: source.contents().chars().collect(),
+            interner: Interner::new(),
+            scratch: String::new(),
             error_manager
         }
     }
@@ -98,11 +104,12 @@ impl Lexer {
         let loc_copy = self.loc.clone();
         self.advance_n(length);
         let pos_copy = loc_copy.pos as usize;
-        let value: String =
-            self.buffer[pos_copy..pos_copy + length].iter().collect();
+        self.scratch.clear();
+        self.scratch
+            .extend(&self.buffer[pos_copy..pos_copy + length]);
         Token {
             ty,
-            value,
+            value: self.interner.intern(&self.scratch),
             loc: loc_copy
         }
     }
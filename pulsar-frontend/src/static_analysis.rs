@@ -14,6 +14,7 @@ use pulsar_utils::{
     environment::Environment,
     error::{Error, ErrorBuilder, ErrorCode, ErrorManager, Level, Style},
     id::Gen,
+    intern::Symbol,
     loc::{Region, RegionProvider},
     CheapClone
 };
@@ -60,7 +61,7 @@ enum TypeConstraint {
 }
 
 pub struct StaticAnalyzer {
-    env: Environment<String, TypeCell>,
+    env: Environment<Symbol, TypeCell>,
     constraints: VecDeque<TypeConstraint>,
     error_manager: Rc<RefCell<ErrorManager>>
 }
@@ -77,7 +78,7 @@ impl StaticAnalyzer {
     /// Establishes a top-level binding for the type `ty` of `name`, useful for
     /// allowing functions to call other functions or external/FFI declarations.
     pub fn bind_top_level(&mut self, name: String, ty: Type) {
-        self.env.bind_base(name, TypeCell::new(ty));
+        self.env.bind_base(name.into(), TypeCell::new(ty));
     }
 
     /// Performs control-flow analysis on functions and infers the types of
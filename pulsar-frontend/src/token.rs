@@ -1,6 +1,9 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
 use core::{fmt, fmt::Debug};
-use pulsar_utils::loc::{Loc, RegionProvider};
+use pulsar_utils::{
+    intern::Symbol,
+    loc::{Loc, RegionProvider}
+};
 
 #[derive(Clone, Copy, PartialEq, Eq)]
 pub enum TokenType {
@@ -107,10 +110,12 @@ impl fmt::Display for TokenType {
     }
 }
 
+/// A token is cheap to clone: its text is an interned [`Symbol`] and its
+/// location shares its source.
 #[derive(Clone)]
 pub struct Token {
     pub ty: TokenType,
-    pub value: String,
+    pub value: Symbol,
     pub loc: Loc
 }
 
@@ -118,7 +123,7 @@ impl Token {
     /// ```
     /// let token = Token {
     ///     ty: TokenType::Identifier,
-    ///     value: "main".to_string(),
+    ///     value: "main".into(),
     ///     loc: Loc::default()
     /// };
     /// assert_eq(token.value.len(), token.length());
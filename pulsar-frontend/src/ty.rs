@@ -74,6 +74,10 @@ impl Type {
         }
     }
 
+    pub fn is_array(&self) -> bool {
+        matches!(self, Self::Array(_, _))
+    }
+
     pub fn as_array_type(&self) -> (TypeCell, isize) {
         match &self {
             Self::Array(element_type, size) => (element_type.clone(), *size),
@@ -0,0 +1,60 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+use std::{
+    env, fs,
+    path::{Path, PathBuf}
+};
+
+// The IR cache must miss the entries written by any other build of the
+// compiler, since they may have been lowered differently. A build is
+// identified by the sources of every crate that lowering goes through, which
+// are hashed here and compiled in as `PULSAR_IR_COMPILER`.
+
+const LOWERING_SOURCES: [&str; 3] =
+    ["src", "../pulsar-frontend/src", "../pulsar-utils/src"];
+
+/// The same FNV-1a as the cache keys, over `bytes` following `hash`.
+fn fnv1a(hash: u64, bytes: &[u8]) -> u64 {
+    bytes.iter().fold(hash, |hash, byte| {
+        (hash ^ *byte as u64).wrapping_mul(0x100000001b3)
+    })
+}
+
+/// Every file under `dir`, in an order that does not depend on the file
+/// system.
+fn files(dir: &Path) -> Vec<PathBuf> {
+    let mut entries = fs::read_dir(dir)
+        .expect("Could not read lowering sources")
+        .map(|entry| entry.expect("Could not read lowering sources").path())
+        .collect::<Vec<_>>();
+    entries.sort();
+    entries
+        .into_iter()
+        .flat_map(|path| {
+            if path.is_dir() {
+                files(&path)
+            } else {
+                vec![path]
+            }
+        })
+        .collect()
+}
+
+fn main() {
+    // through any symlink, so that the other crates are found beside it
+    let root = fs::canonicalize(env::var("CARGO_MANIFEST_DIR").unwrap())
+        .expect("Could not find the crate");
+    let mut hash = 0xcbf29ce484222325;
+    for sources in LOWERING_SOURCES {
+        let sources = root.join(sources);
+        println!("cargo:rerun-if-changed={}", sources.display());
+        for file in files(&sources) {
+            let name = file.strip_prefix(&root).unwrap_or(&file);
+            hash = fnv1a(hash, name.to_string_lossy().as_bytes());
+            hash = fnv1a(
+                hash,
+                &fs::read(&file).expect("Could not read lowering sources")
+            );
+        }
+    }
+    println!("cargo:rustc-env=PULSAR_IR_COMPILER={:016x}", hash);
+}
@@ -0,0 +1,443 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+use super::{
+    branch_condition::BranchCondition,
+    control_flow_graph::ControlFlowGraph,
+    generator::GeneratedTopLevel,
+    label::{Label, LabelName, LabelVisibility},
+    operand::Operand,
+    variable::Variable,
+    Ir
+};
+use pulsar_frontend::{
+    ast::Node,
+    ty::{Type, TypeCell}
+};
+use std::{
+    collections::HashMap,
+    fmt::Write as _,
+    fs, io,
+    path::PathBuf,
+    process,
+    sync::atomic::{AtomicUsize, Ordering}
+};
+
+// A function is cached as text, one IR instruction per line, under a key that
+// hashes its source along with the signatures of the functions it names. Its
+// IR depends on nothing else: every function declares its signature, so type
+// inference never looks into the body of another function. A function whose
+// body changes is therefore compiled again alone, while the functions that
+// call it are only compiled again when its signature changes.
+
+/// Changed whenever the format below does, so that entries written by an
+/// older compiler are missed instead of misread.
+const CACHE_FORMAT: &str = "pulsar ir cache 1";
+
+/// Identifies this build of the compiler by the sources that lowering
+/// depends on (see `build.rs`), so that IR lowered by any other build is
+/// missed.
+pub const COMPILER: &str = env!("PULSAR_IR_COMPILER");
+
+/// Distinguishes the temporary files of concurrent stores from one process.
+static STORES: AtomicUsize = AtomicUsize::new(0);
+
+/// FNV-1a, which unlike the hashers of the standard library is specified to
+/// hash the same way in every build, as keys that are saved to disk must.
+fn fnv1a(bytes: &[u8]) -> u64 {
+    bytes.iter().fold(0xcbf29ce484222325, |hash, byte| {
+        (hash ^ *byte as u64).wrapping_mul(0x100000001b3)
+    })
+}
+
+fn encode_type(ty: &Type) -> Option<String> {
+    match ty {
+        Type::Unit | Type::Int64 | Type::Name(_) => Some(ty.to_string()),
+        Type::Array(element_type, size) if *size >= 0 => Some(format!(
+            "{}[{}]",
+            encode_type(&element_type.as_ref())?,
+            size
+        )),
+        _ => None
+    }
+}
+
+fn decode_type(text: &str) -> Option<Type> {
+    if let Some(text) = text.strip_suffix(']') {
+        let (element_type, size) = text.rsplit_once('[')?;
+        let size = size.parse::<isize>().ok().filter(|size| *size >= 0)?;
+        return Some(Type::Array(
+            TypeCell::new(decode_type(element_type)?),
+            size
+        ));
+    }
+    match text {
+        "Unit" => Some(Type::Unit),
+        "Int64" => Some(Type::Int64),
+        _ if !text.is_empty()
+            && text.chars().all(|c| c.is_alphanumeric() || c == '_') =>
+        {
+            Some(Type::Name(text.into()))
+        }
+        _ => None
+    }
+}
+
+fn encode_label(name: &LabelName) -> String {
+    format!(
+        "{} {} {}",
+        name.is_native as u8, name.unmangled, name.mangled
+    )
+}
+
+fn decode_label<'a>(
+    words: &mut impl Iterator<Item = &'a str>
+) -> Option<LabelName> {
+    let is_native = decode_bool(words.next()?)?;
+    Some(LabelName {
+        unmangled: words.next()?.into(),
+        mangled: words.next()?.into(),
+        is_native
+    })
+}
+
+fn decode_bool(word: &str) -> Option<bool> {
+    match word {
+        "0" => Some(false),
+        "1" => Some(true),
+        _ => None
+    }
+}
+
+/// Names the variables of a function in the order they first appear, so
+/// that it is stored the same way whatever its variables were numbered.
+#[derive(Default)]
+struct Encoder {
+    vars: HashMap<Variable, usize>
+}
+
+impl Encoder {
+    fn var(&mut self, var: &Variable) -> String {
+        let next = self.vars.len();
+        format!("v{}", self.vars.entry(*var).or_insert(next))
+    }
+
+    fn operand(&mut self, value: &Operand) -> String {
+        match value {
+            Operand::Constant(value) => value.to_string(),
+            Operand::Variable(var) => self.var(var)
+        }
+    }
+
+    fn ir(&mut self, ir: &Ir) -> String {
+        match ir {
+            Ir::Add(result, lhs, rhs) => format!(
+                "add {} {} {}",
+                self.var(result),
+                self.operand(lhs),
+                self.operand(rhs)
+            ),
+            Ir::Mul(result, lhs, rhs) => format!(
+                "mul {} {} {}",
+                self.var(result),
+                self.operand(lhs),
+                self.operand(rhs)
+            ),
+            Ir::Assign(result, value) => {
+                format!("assign {} {}", self.var(result), self.operand(value))
+            }
+            Ir::GetParam(result) => format!("param {}", self.var(result)),
+            Ir::Return(None) => "ret".into(),
+            Ir::Return(Some(value)) => format!("ret {}", self.operand(value)),
+            Ir::LocalAlloc(result, size, count) => {
+                format!("alloc {} {} {}", self.var(result), size, count)
+            }
+            Ir::Store {
+                result,
+                value,
+                index
+            } => format!(
+                "store {} {} {}",
+                self.var(result),
+                self.operand(value),
+                self.operand(index)
+            ),
+            Ir::Load {
+                result,
+                value,
+                index
+            } => format!(
+                "load {} {} {}",
+                self.var(result),
+                self.operand(value),
+                self.operand(index)
+            ),
+            Ir::Map {
+                result,
+                parallel_factor,
+                f,
+                input,
+                length
+            } => format!(
+                "map {} {} {} {} {}",
+                self.var(result),
+                parallel_factor,
+                encode_label(f),
+                self.operand(input),
+                length
+            ),
+            Ir::Call(result_opt, f, args) => {
+                let mut line = format!(
+                    "call {} {}",
+                    result_opt
+                        .as_ref()
+                        .map_or_else(|| "-".into(), |result| self.var(result)),
+                    encode_label(f)
+                );
+                for arg in args {
+                    line.push(' ');
+                    line.push_str(&self.operand(arg));
+                }
+                line
+            }
+        }
+    }
+}
+
+/// Gives each variable of a function a fresh variable the first time it is
+/// read back.
+#[derive(Default)]
+struct Decoder {
+    vars: HashMap<String, Variable>
+}
+
+impl Decoder {
+    fn var(&mut self, word: &str) -> Option<Variable> {
+        if !word.starts_with('v') {
+            return None;
+        }
+        Some(*self.vars.entry(word.into()).or_insert_with(Variable::new))
+    }
+
+    fn operand(&mut self, word: &str) -> Option<Operand> {
+        if word.starts_with('v') {
+            self.var(word).map(Operand::Variable)
+        } else {
+            word.parse().ok().map(Operand::Constant)
+        }
+    }
+
+    fn ir(&mut self, line: &str) -> Option<Ir> {
+        let mut words = line.split(' ');
+        let ir = match words.next()? {
+            "add" => Ir::Add(
+                self.var(words.next()?)?,
+                self.operand(words.next()?)?,
+                self.operand(words.next()?)?
+            ),
+            "mul" => Ir::Mul(
+                self.var(words.next()?)?,
+                self.operand(words.next()?)?,
+                self.operand(words.next()?)?
+            ),
+            "assign" => Ir::Assign(
+                self.var(words.next()?)?,
+                self.operand(words.next()?)?
+            ),
+            "param" => Ir::GetParam(self.var(words.next()?)?),
+            "ret" => Ir::Return(match words.next() {
+                Some(word) => Some(self.operand(word)?),
+                None => None
+            }),
+            "alloc" => Ir::LocalAlloc(
+                self.var(words.next()?)?,
+                words.next()?.parse().ok()?,
+                words.next()?.parse().ok()?
+            ),
+            "store" => Ir::Store {
+                result: self.var(words.next()?)?,
+                value: self.operand(words.next()?)?,
+                index: self.operand(words.next()?)?
+            },
+            "load" => Ir::Load {
+                result: self.var(words.next()?)?,
+                value: self.operand(words.next()?)?,
+                index: self.operand(words.next()?)?
+            },
+            "map" => Ir::Map {
+                result: self.var(words.next()?)?,
+                parallel_factor: words.next()?.parse().ok()?,
+                f: decode_label(&mut words)?,
+                input: self.operand(words.next()?)?,
+                length: words.next()?.parse().ok()?
+            },
+            "call" => {
+                let result_opt = match words.next()? {
+                    "-" => None,
+                    word => Some(self.var(word)?)
+                };
+                let f = decode_label(&mut words)?;
+                let args = words
+                    .by_ref()
+                    .map(|word| self.operand(word))
+                    .collect::<Option<Vec<_>>>()?;
+                Ir::Call(result_opt, f, args)
+            }
+            _ => return None
+        };
+        // anything left over means the entry is not one this wrote
+        words.next().is_none().then_some(ir)
+    }
+}
+
+/// The text `function` is cached as, or `None` if it is not one this cache
+/// can hold, which is any function whose IR left the entry block.
+fn encode(function: &GeneratedTopLevel) -> Option<String> {
+    match function {
+        GeneratedTopLevel::Function {
+            label,
+            args,
+            ret,
+            is_pure,
+            cfg
+        } => {
+            let entry = cfg.entry();
+            if cfg.size() != 1
+                || entry.as_ref().branch_condition() != BranchCondition::Never
+            {
+                return None;
+            }
+            let mut out = String::new();
+            let _ = writeln!(out, "{}", CACHE_FORMAT);
+            let _ = writeln!(
+                out,
+                "func {} {} {}",
+                label.visibility,
+                *is_pure as u8,
+                encode_label(&label.name)
+            );
+            out.push_str("args");
+            for arg in args {
+                let _ = write!(out, " {}", encode_type(arg)?);
+            }
+            let _ = writeln!(out, "\nret {}", encode_type(ret)?);
+            let mut encoder = Encoder::default();
+            for ir in entry.as_ref().into_iter() {
+                let _ = writeln!(out, "{}", encoder.ir(ir));
+            }
+            Some(out)
+        }
+    }
+}
+
+fn decode(text: &str) -> Option<GeneratedTopLevel> {
+    let mut lines = text.lines();
+    if lines.next()? != CACHE_FORMAT {
+        return None;
+    }
+
+    let mut header = lines.next()?.split(' ');
+    if header.next()? != "func" {
+        return None;
+    }
+    let visibility = match header.next()? {
+        "public" => LabelVisibility::Public,
+        "private" => LabelVisibility::Private,
+        "external" => LabelVisibility::External,
+        _ => return None
+    };
+    let is_pure = decode_bool(header.next()?)?;
+    let name = decode_label(&mut header)?;
+
+    let mut args = lines.next()?.split(' ');
+    if args.next()? != "args" {
+        return None;
+    }
+    let args = args.map(decode_type).collect::<Option<Vec<_>>>()?;
+    let ret = decode_type(lines.next()?.strip_prefix("ret ")?)?;
+
+    let cfg = ControlFlowGraph::new();
+    let entry = cfg.entry();
+    let mut decoder = Decoder::default();
+    for line in lines {
+        let ir = decoder.ir(line)?;
+        entry.as_mut().add(ir);
+    }
+    Some(GeneratedTopLevel::Function {
+        label: Label::from(name, visibility),
+        args,
+        ret: Box::new(ret),
+        is_pure,
+        cfg
+    })
+}
+
+/// An on-disk cache of the IR generated for each function of a program, so
+/// that functions that have not changed since they were last compiled are
+/// neither type-inferred nor generated again.
+pub struct IrCache {
+    dir: PathBuf,
+    compiler: String
+}
+
+impl IrCache {
+    /// Opens the cache in `dir` for this build of the compiler, creating the
+    /// directory if needed.
+    pub fn new(dir: PathBuf) -> io::Result<Self> {
+        Self::for_compiler(dir, COMPILER)
+    }
+
+    /// Like [`IrCache::new`], but for the build of the compiler identified
+    /// by `compiler`, which misses the entries of every other build.
+    pub fn for_compiler(dir: PathBuf, compiler: &str) -> io::Result<Self> {
+        fs::create_dir_all(&dir)?;
+        Ok(Self {
+            dir,
+            compiler: compiler.into()
+        })
+    }
+
+    /// The key that the IR of the function `node` is cached under, where
+    /// `signatures` maps the function names of the program to their types
+    /// (see [`Node::signature`]). It must be taken before type inference
+    /// annotates `node`.
+    pub fn key(&self, node: &Node, signatures: &HashMap<String, Type>) -> u64 {
+        let mut content =
+            format!("{}\n{}\n{}\n", CACHE_FORMAT, self.compiler, node);
+        for name in node.names() {
+            if let Some(ty) = signatures.get(name) {
+                let _ = writeln!(content, "{}: {}", name, ty);
+            }
+        }
+        fnv1a(content.as_bytes())
+    }
+
+    fn path(&self, key: u64) -> PathBuf {
+        self.dir.join(format!("{:016x}.ir", key))
+    }
+
+    /// The IR cached under `key`, with fresh variables, or `None` if there is
+    /// none or it cannot be read.
+    pub fn load(&self, key: u64) -> Option<GeneratedTopLevel> {
+        decode(&fs::read_to_string(self.path(key)).ok()?)
+    }
+
+    /// Caches the IR `function` under `key`. This fails with
+    /// [`io::ErrorKind::InvalidInput`] for IR the cache cannot hold, which
+    /// only costs compiling the function again next time.
+    pub fn store(
+        &self, key: u64, function: &GeneratedTopLevel
+    ) -> io::Result<()> {
+        let text = encode(function).ok_or_else(|| {
+            io::Error::new(io::ErrorKind::InvalidInput, "IR cannot be cached")
+        })?;
+        // written aside and renamed into place so that concurrent compiles
+        // never read a partial entry
+        let path = self.path(key);
+        let partial = path.with_extension(format!(
+            "{}.{}",
+            process::id(),
+            STORES.fetch_add(1, Ordering::Relaxed)
+        ));
+        fs::write(&partial, text)?;
+        fs::rename(&partial, &path)
+    }
+}
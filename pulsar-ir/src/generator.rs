@@ -12,7 +12,7 @@ use pulsar_frontend::{
     token::{Token, TokenType},
     ty::Type
 };
-use pulsar_utils::environment::Environment;
+use pulsar_utils::{environment::Environment, intern::Symbol};
 use std::fmt::Display;
 
 pub enum GeneratedTopLevel {
@@ -54,7 +54,7 @@ impl Display for GeneratedTopLevel {
 
 pub struct Generator {
     program: Box<dyn Iterator<Item = Node>>,
-    env: Environment<String, Variable>
+    env: Environment<Symbol, Variable>
 }
 
 impl Generator {
@@ -102,7 +102,7 @@ impl Generator {
                 block.as_mut().add(Ir::Call(
                     result_opt,
                     LabelName::from_native(
-                        name.value.clone(),
+                        name.value.to_string(),
                         &arg_tys,
                         &Box::new(expr.ty.clone_out())
                     ),
@@ -174,7 +174,7 @@ impl Generator {
                     result,
                     parallel_factor: *parallel_factor,
                     f: LabelName::from_native(
-                        f.value.clone(),
+                        f.value.to_string(),
                         &vec![Type::Int64],
                         &Box::new(Type::Int64)
                     ),
@@ -233,7 +233,11 @@ impl Generator {
         let ret_ty = Box::new(ret);
         GeneratedTopLevel::Function {
             label: Label::from(
-                LabelName::from_native(name.value.clone(), &arg_tys, &ret_ty),
+                LabelName::from_native(
+                    name.value.to_string(),
+                    &arg_tys,
+                    &ret_ty
+                ),
                 LabelVisibility::Private
             ),
             args: arg_tys,
@@ -7,9 +7,9 @@ use std::fmt::{Display, Formatter};
 pub const MAIN_SYMBOL_PREFIX: &str = "_pulsar_Smain";
 
 pub struct LabelName {
-    unmangled: String,
-    mangled: String,
-    is_native: bool
+    pub(crate) unmangled: String,
+    pub(crate) mangled: String,
+    pub(crate) is_native: bool
 }
 
 impl LabelName {
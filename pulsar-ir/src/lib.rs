@@ -8,9 +8,11 @@ use std::fmt::Display;
 
 pub mod basic_block;
 pub mod branch_condition;
+pub mod cache;
 pub mod control_flow_graph;
 pub mod generator;
 pub mod label;
+pub mod lower;
 pub mod operand;
 pub mod variable;
 
@@ -0,0 +1,213 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+use super::{
+    cache::IrCache,
+    generator::{GeneratedTopLevel, Generator}
+};
+use pulsar_frontend::{ast::Node, static_analysis::StaticAnalyzer, ty::Type};
+use pulsar_utils::{
+    digraph::Digraph, error::ErrorManager, id::Gen, stats::Phases
+};
+use std::{
+    cell::RefCell,
+    collections::HashMap,
+    rc::Rc,
+    sync::{
+        atomic::{AtomicUsize, Ordering},
+        Mutex
+    },
+    thread
+};
+
+/// The stack each compile thread runs on, which recursive descent parsing
+/// and type inference of large programs need more of than the default.
+pub const WORKER_STACK_SIZE: usize = 64 * 1024 * 1024;
+
+/// Type-checks `program` and generates IR for each of its functions, in
+/// program order, recording its errors in `error_manager` and its phases in
+/// `phases`. Functions whose IR is in `cache` are loaded from it instead, and
+/// the IR of the others is stored there. With `threads`, the strongly
+/// connected components of the call graph are lowered independently on up to
+/// that many threads. Returns `None` if any function failed to type-check.
+pub fn lower_program(
+    program: Vec<Node>, cache: Option<&IrCache>, threads: Option<usize>,
+    error_manager: &Rc<RefCell<ErrorManager>>, phases: &mut Phases
+) -> Option<Vec<GeneratedTopLevel>> {
+    // a cached function keeps its place in the program, and the functions
+    // compiled around it can still call it by its signature
+    let signatures = program
+        .iter()
+        .filter_map(Node::signature)
+        .collect::<HashMap<_, _>>();
+    let mut cached = vec![];
+    let mut changed = vec![];
+    let mut keys = vec![];
+    phases.measure("cache-load", || {
+        for node in program {
+            let key = cache.map(|cache| (cache, cache.key(&node, &signatures)));
+            match key.and_then(|(cache, key)| cache.load(key)) {
+                Some(generated) => cached.push(Some(generated)),
+                None => {
+                    keys.push(key);
+                    changed.push(node);
+                    cached.push(None);
+                }
+            }
+        }
+    });
+
+    let generated = match threads {
+        Some(threads) => phases.measure("infer-generate", || {
+            lower_in_parallel(changed, &signatures, threads, error_manager)
+        }),
+        None => lower(changed, &signatures, error_manager, phases)
+    }?;
+
+    let mut generated = generated.into_iter().zip(keys);
+    Some(phases.measure("cache-store", || {
+        cached
+            .into_iter()
+            .filter_map(|cached| {
+                cached.or_else(|| {
+                    let (generated, key) = generated.next()?;
+                    if let Some((cache, key)) = key {
+                        // failing to store only costs generating it again
+                        let _ = cache.store(key, &generated);
+                    }
+                    Some(generated)
+                })
+            })
+            .collect()
+    }))
+}
+
+/// Type-checks and generates IR for the functions in `program` on this
+/// thread, which may call any function in `signatures`, recording each in
+/// `phases`.
+fn lower(
+    program: Vec<Node>, signatures: &HashMap<String, Type>,
+    error_manager: &Rc<RefCell<ErrorManager>>, phases: &mut Phases
+) -> Option<Vec<GeneratedTopLevel>> {
+    let annotated_ast = phases.measure("infer", || {
+        let mut type_inferer = StaticAnalyzer::new(error_manager.clone());
+        for (name, ty) in signatures {
+            type_inferer.bind_top_level(name.clone(), ty.clone());
+        }
+        type_inferer.infer(program)
+    })?;
+    Some(phases.measure("generate", || Generator::new(annotated_ast).collect()))
+}
+
+/// Like [`lower`], but on up to `threads` threads at once. Every function
+/// declares its signature, so the strongly connected components of the call
+/// graph can be type-checked and generated independently, each with its own
+/// analyzer and errors. The errors are recorded in `error_manager` in the
+/// order of the program, and the variables of each component are numbered
+/// from zero, so the result does not depend on how the components were
+/// scheduled.
+fn lower_in_parallel(
+    program: Vec<Node>, signatures: &HashMap<String, Type>, threads: usize,
+    error_manager: &Rc<RefCell<ErrorManager>>
+) -> Option<Vec<GeneratedTopLevel>> {
+    let positions = program
+        .iter()
+        .enumerate()
+        .filter_map(|(i, node)| Some((node.signature()?.0, i)))
+        .collect::<HashMap<_, _>>();
+    let mut calls = Digraph::new();
+    for i in 0..program.len() {
+        calls.add_node(i);
+    }
+    for (i, node) in program.iter().enumerate() {
+        for name in node.names() {
+            if let Some(callee) = positions.get(name) {
+                calls.add_edge(i, (), *callee);
+            }
+        }
+    }
+    let mut components = calls.strongly_connected_components();
+    for component in &mut components {
+        component.sort();
+    }
+    components.sort();
+
+    let mut program = program.into_iter().map(Some).collect::<Vec<_>>();
+    let units = components
+        .iter()
+        .map(|component| {
+            let unit = component
+                .iter()
+                .map(|i| (*i, program[*i].take().unwrap()))
+                .collect::<Vec<_>>();
+            Mutex::new(Some(unit))
+        })
+        .collect::<Vec<_>>();
+
+    let max_errors = error_manager.borrow().max_count();
+    let next = AtomicUsize::new(0);
+    let mut outcomes = thread::scope(|scope| {
+        let workers = (0..threads.clamp(1, units.len().max(1)))
+            .map(|_| {
+                let worker = || {
+                    let mut outcomes = vec![];
+                    loop {
+                        let index = next.fetch_add(1, Ordering::Relaxed);
+                        let unit = match units.get(index) {
+                            Some(unit) => unit.lock().unwrap().take().unwrap(),
+                            None => break
+                        };
+                        let (positions, unit): (Vec<_>, Vec<_>) =
+                            unit.into_iter().unzip();
+                        Gen::reset();
+                        let unit_errors =
+                            ErrorManager::with_max_count(max_errors);
+                        // unrecorded, since the caller measures all the
+                        // workers together
+                        let generated = lower(
+                            unit,
+                            signatures,
+                            &unit_errors,
+                            &mut Phases::new()
+                        )
+                        .map(|generated| {
+                            positions
+                                .into_iter()
+                                .zip(generated)
+                                .collect::<Vec<_>>()
+                        });
+                        let errors = unit_errors.borrow_mut().take_errors();
+                        outcomes.push((index, generated, errors));
+                    }
+                    outcomes
+                };
+                thread::Builder::new()
+                    .stack_size(WORKER_STACK_SIZE)
+                    .spawn_scoped(scope, worker)
+                    .expect("Could not start a compile thread")
+            })
+            .collect::<Vec<_>>();
+        workers
+            .into_iter()
+            .flat_map(|worker| {
+                worker.join().expect("A compile thread panicked")
+            })
+            .collect::<Vec<_>>()
+    });
+
+    outcomes.sort_by_key(|(index, _, _)| *index);
+    let mut generated_code = vec![];
+    let mut failed = false;
+    for (_, generated, errors) in outcomes {
+        for error in errors {
+            error_manager.borrow_mut().record(error);
+        }
+        match generated {
+            Some(generated) => generated_code.extend(generated),
+            None => failed = true
+        }
+    }
+    if failed {
+        return None;
+    }
+    generated_code.sort_by_key(|(position, _)| *position);
+    Some(generated_code.into_iter().map(|(_, code)| code).collect())
+}
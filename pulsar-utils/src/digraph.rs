@@ -62,4 +62,66 @@ impl<Node: Hash + Eq + Clone, Edge> Digraph<Node, Edge> {
             }
         }
     }
+
+    /// The strongly connected components of the graph, each of which has
+    /// every node that can reach and be reached by one another. Every
+    /// component is listed after all of the components it has edges into,
+    /// but the order is otherwise unspecified, as is the order within each
+    /// component.
+    pub fn strongly_connected_components(&self) -> Vec<Vec<Node>> {
+        // Tarjan's algorithm, with an explicit stack of the nodes being
+        // visited and how many of their edges have been followed, so that
+        // long paths do not overflow the call stack
+        let mut index = HashMap::new();
+        let mut low_link = HashMap::new();
+        let mut stack = vec![];
+        let mut on_stack = HashSet::new();
+        let mut components = vec![];
+        for root in self.adj.keys() {
+            if index.contains_key(root) {
+                continue;
+            }
+            let mut visiting = vec![(root.clone(), 0)];
+            index.insert(root.clone(), index.len());
+            low_link.insert(root.clone(), index[root]);
+            stack.push(root.clone());
+            on_stack.insert(root.clone());
+            while let Some((node, edge)) = visiting.last().cloned() {
+                let out = self.adj.get(&node).map_or(&[][..], |out| &out[..]);
+                if let Some((_, next)) = out.get(edge) {
+                    visiting.last_mut().unwrap().1 += 1;
+                    if !index.contains_key(next) {
+                        index.insert(next.clone(), index.len());
+                        low_link.insert(next.clone(), index[next]);
+                        stack.push(next.clone());
+                        on_stack.insert(next.clone());
+                        visiting.push((next.clone(), 0));
+                    } else if on_stack.contains(next) {
+                        let low = low_link[&node].min(index[next]);
+                        low_link.insert(node, low);
+                    }
+                    continue;
+                }
+
+                visiting.pop();
+                if let Some((parent, _)) = visiting.last() {
+                    let low = low_link[parent].min(low_link[&node]);
+                    low_link.insert(parent.clone(), low);
+                }
+                if low_link[&node] == index[&node] {
+                    let mut component = vec![];
+                    while let Some(member) = stack.pop() {
+                        on_stack.remove(&member);
+                        let is_root = member == node;
+                        component.push(member);
+                        if is_root {
+                            break;
+                        }
+                    }
+                    components.push(component);
+                }
+            }
+        }
+        components
+    }
 }
@@ -16,7 +16,8 @@ pub enum ErrorCode {
     InvalidOperatorSyntax,
     MalformedType,
     UnboundName,
-    StaticAnalysisIssue
+    StaticAnalysisIssue,
+    UnsupportedByBackend
 }
 
 impl Display for ErrorCode {
@@ -322,6 +323,11 @@ impl ErrorManager {
         !self.errors.is_empty()
     }
 
+    /// How many primary errors the error manager can record.
+    pub fn max_count(&self) -> usize {
+        self.max_count
+    }
+
     /// Whether the error manager cannot take any further primary errors.
     pub fn is_full(&self) -> bool {
         self.primary_count == self.max_count
@@ -340,6 +346,13 @@ impl ErrorManager {
         }
     }
 
+    /// Removes and returns all recorded errors, e.g., to record them with the
+    /// error manager of another thread.
+    pub fn take_errors(&mut self) -> Vec<Error> {
+        self.primary_count = 0;
+        std::mem::take(&mut self.errors)
+    }
+
     /// Prints and clears all recorded errors to `output`.
     pub fn consume_and_write<W: io::Write>(
         &mut self, output: &mut W
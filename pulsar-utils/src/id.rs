@@ -1,31 +1,33 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
-use lazy_static::lazy_static;
-use std::{collections::HashMap, sync::Mutex};
+use std::{cell::RefCell, collections::HashMap};
 
 pub type Id = i64;
 
-pub struct Gen {
-    id_map: Mutex<HashMap<&'static str, Id>>
-}
+pub struct Gen;
 
-lazy_static! {
-    static ref GEN_SINGLETON: Gen = Gen {
-        id_map: Mutex::new(HashMap::new())
-    };
+thread_local! {
+    /// Each thread numbers its own identifiers, so that programs compiled
+    /// concurrently are numbered as if each were compiled alone.
+    static ID_MAP: RefCell<HashMap<&'static str, Id>> =
+        RefCell::new(HashMap::new());
 }
 
 impl Gen {
     /// Returns an identifier unique among all [`Gen::next`] calls with the same
-    /// argument `name`.
+    /// argument `name` on this thread since it last called [`Gen::reset`].
     pub fn next(name: &'static str) -> Id {
-        let mut id_map = GEN_SINGLETON.id_map.lock().unwrap();
-        if let Some(id) = id_map.get_mut(&name) {
+        ID_MAP.with(|id_map| {
+            let mut id_map = id_map.borrow_mut();
+            let id = id_map.entry(name).or_insert(0);
             let result = *id;
             *id += 1;
             result
-        } else {
-            id_map.insert(name, 1);
-            0
-        }
+        })
+    }
+
+    /// Restarts every sequence of identifiers on this thread, e.g. before
+    /// compiling another program.
+    pub fn reset() {
+        ID_MAP.with(|id_map| id_map.borrow_mut().clear());
     }
 }
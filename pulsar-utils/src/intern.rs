@@ -0,0 +1,100 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+use std::{
+    borrow::Borrow,
+    collections::HashSet,
+    fmt::{self, Debug, Display},
+    ops::Deref,
+    sync::Arc
+};
+
+/// An immutable string shared by every copy of it, so that cloning one costs a
+/// reference count instead of an allocation. Symbols made by the same
+/// [`Interner`] with the same contents share the same allocation.
+#[derive(Clone, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub struct Symbol(Arc<str>);
+
+impl Symbol {
+    pub fn as_str(&self) -> &str {
+        &self.0
+    }
+}
+
+impl Deref for Symbol {
+    type Target = str;
+
+    fn deref(&self) -> &str {
+        &self.0
+    }
+}
+
+impl Borrow<str> for Symbol {
+    fn borrow(&self) -> &str {
+        &self.0
+    }
+}
+
+impl AsRef<str> for Symbol {
+    fn as_ref(&self) -> &str {
+        &self.0
+    }
+}
+
+impl From<&str> for Symbol {
+    fn from(value: &str) -> Self {
+        Symbol(value.into())
+    }
+}
+
+impl From<String> for Symbol {
+    fn from(value: String) -> Self {
+        Symbol(value.into())
+    }
+}
+
+impl PartialEq<str> for Symbol {
+    fn eq(&self, other: &str) -> bool {
+        self.as_str() == other
+    }
+}
+
+impl PartialEq<&str> for Symbol {
+    fn eq(&self, other: &&str) -> bool {
+        self.as_str() == *other
+    }
+}
+
+impl Display for Symbol {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        Display::fmt(self.as_str(), f)
+    }
+}
+
+impl Debug for Symbol {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        Debug::fmt(self.as_str(), f)
+    }
+}
+
+/// Hands out one [`Symbol`] per distinct string, e.g., so that every token
+/// for the same identifier shares its text.
+#[derive(Default)]
+pub struct Interner {
+    symbols: HashSet<Symbol>
+}
+
+impl Interner {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// The symbol for `value`, which is only allocated the first time `value`
+    /// is interned.
+    pub fn intern(&mut self, value: &str) -> Symbol {
+        if let Some(symbol) = self.symbols.get(value) {
+            return symbol.clone();
+        }
+        let symbol = Symbol::from(value);
+        self.symbols.insert(symbol.clone());
+        symbol
+    }
+}
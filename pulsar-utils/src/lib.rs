@@ -13,8 +13,10 @@ pub mod environment;
 pub mod error;
 pub mod format;
 pub mod id;
+pub mod intern;
 pub mod loc;
 pub mod mutcell;
+pub mod stats;
 
 /// A type whose `clone()` involves copying no more than 8-16 bytes of data.
 pub trait CheapClone: Clone {}
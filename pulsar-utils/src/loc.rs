@@ -1,5 +1,5 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
-use std::{cmp::Ordering, fmt::Display, rc::Rc};
+use std::{cmp::Ordering, fmt::Display, sync::Arc};
 
 /// Different sources of text data.
 #[derive(Clone, Debug, Eq)]
@@ -18,8 +18,8 @@ pub enum Source {
 }
 
 impl Source {
-    pub fn file(name: String, contents: String) -> Rc<Source> {
-        Rc::new(Source::File { name, contents })
+    pub fn file(name: String, contents: String) -> Arc<Source> {
+        Arc::new(Source::File { name, contents })
     }
 
     /// `contents(source)` is the string contents of `source`.
@@ -138,7 +138,7 @@ pub struct Loc {
     pub line: isize,
     pub col: isize,
     pub pos: isize,
-    pub source: Rc<Source>
+    pub source: Arc<Source>
 }
 
 impl Loc {
@@ -157,7 +157,7 @@ impl Loc {
             line: 0,
             col: 0,
             pos: 0,
-            source: Rc::new(Source::Unknown)
+            source: Arc::new(Source::Unknown)
         }
     }
 
@@ -181,7 +181,7 @@ impl Default for Loc {
             line: 1,
             col: 1,
             pos: 0,
-            source: Rc::new(Source::Unknown)
+            source: Arc::new(Source::Unknown)
         }
     }
 }
@@ -264,7 +264,7 @@ impl Region {
     }
 
     /// The source where this region occurs.
-    pub fn source(&self) -> Rc<Source> {
+    pub fn source(&self) -> Arc<Source> {
         self.start.source.clone()
     }
 
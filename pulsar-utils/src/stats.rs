@@ -0,0 +1,206 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    fmt::Write,
+    sync::atomic::{AtomicBool, AtomicIsize, AtomicUsize, Ordering},
+    time::{Duration, Instant}
+};
+
+/// Whether [`CountingAllocator`] counts, which it only does once a
+/// [`Phases::recording`] has been made.
+static COUNTING: AtomicBool = AtomicBool::new(false);
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+// signed because memory allocated before counting started is freed after
+static HEAP: AtomicIsize = AtomicIsize::new(0);
+static PEAK_HEAP: AtomicIsize = AtomicIsize::new(0);
+
+/// The system allocator, counting every allocation and the bytes in use so
+/// that [`Phases`] can report them. Until phases are recorded, it only checks
+/// that it need not count. A program opts in by installing it:
+///
+/// ```
+/// use pulsar_utils::stats::CountingAllocator;
+///
+/// #[global_allocator]
+/// static ALLOCATOR: CountingAllocator = CountingAllocator;
+/// ```
+///
+/// Otherwise every phase reports zero allocations.
+pub struct CountingAllocator;
+
+impl CountingAllocator {
+    /// Counts an allocation that grew the heap by `size` bytes, which may be
+    /// negative for one that shrank it.
+    fn count(allocations: usize, size: isize) {
+        if COUNTING.load(Ordering::Relaxed) {
+            ALLOCATIONS.fetch_add(allocations, Ordering::Relaxed);
+            let heap = HEAP.fetch_add(size, Ordering::Relaxed) + size;
+            PEAK_HEAP.fetch_max(heap, Ordering::Relaxed);
+        }
+    }
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        Self::count(1, layout.size() as isize);
+        System.alloc(layout)
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        Self::count(1, layout.size() as isize);
+        System.alloc_zeroed(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        Self::count(0, -(layout.size() as isize));
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(
+        &self, ptr: *mut u8, layout: Layout, new_size: usize
+    ) -> *mut u8 {
+        Self::count(1, new_size as isize - layout.size() as isize);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+/// The most memory the process has had resident at once, in bytes, if the
+/// platform reports it.
+fn peak_rss() -> Option<u64> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|line| line.starts_with("VmHWM:"))?;
+    let kilobytes = line.split_whitespace().nth(1)?.parse::<u64>().ok()?;
+    Some(kilobytes * 1024)
+}
+
+/// Restarts [`peak_rss`] from the memory resident now, where the platform
+/// allows it.
+fn reset_peak_rss() {
+    let _ = std::fs::write("/proc/self/clear_refs", "5");
+}
+
+/// Where one phase of a compile spent its time and memory.
+pub struct Phase {
+    pub name: String,
+    pub time: Duration,
+    /// Allocations made while the phase ran, including reallocations.
+    pub allocations: usize,
+    /// The most heap in use at once while the phase ran, beyond what was in
+    /// use when it started.
+    pub peak_heap: usize,
+    /// The most memory resident at once while the phase ran, where the
+    /// platform reports it. If it cannot be reset between phases, this is the
+    /// peak of the process so far.
+    pub peak_rss: Option<u64>
+}
+
+/// The phases of a compile in the order they ran.
+///
+/// The counters are shared by the whole process, and each phase restarts the
+/// peaks, so phases must not be measured while anything else that allocates
+/// runs, e.g., another compile in a batch with several jobs.
+#[derive(Default)]
+pub struct Phases {
+    recording: bool,
+    phases: Vec<Phase>
+}
+
+impl Phases {
+    /// Phases that are not recorded, so that measuring one only runs it.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Phases that are recorded, which starts [`CountingAllocator`] counting
+    /// if it is installed.
+    pub fn recording() -> Self {
+        COUNTING.store(true, Ordering::Relaxed);
+        Self {
+            recording: true,
+            phases: vec![]
+        }
+    }
+
+    /// Runs `phase`, recording it under `name` if these phases are recorded,
+    /// and returns its result.
+    pub fn measure<T>(&mut self, name: &str, phase: impl FnOnce() -> T) -> T {
+        if !self.recording {
+            return phase();
+        }
+        reset_peak_rss();
+        let heap = HEAP.load(Ordering::Relaxed);
+        PEAK_HEAP.store(heap, Ordering::Relaxed);
+        let allocations = ALLOCATIONS.load(Ordering::Relaxed);
+        let start = Instant::now();
+        let result = phase();
+        let time = start.elapsed();
+        let allocations = ALLOCATIONS.load(Ordering::Relaxed) - allocations;
+        let peak_heap =
+            (PEAK_HEAP.load(Ordering::Relaxed) - heap).max(0) as usize;
+        self.phases.push(Phase {
+            name: name.to_string(),
+            time,
+            allocations,
+            peak_heap,
+            peak_rss: peak_rss()
+        });
+        result
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = &Phase> {
+        self.phases.iter()
+    }
+
+    /// Records `phase` as if it had just been measured.
+    pub fn push(&mut self, phase: Phase) {
+        self.phases.push(phase);
+    }
+
+    /// One line per phase, each labeled with `label`.
+    pub fn to_text(&self, label: &str) -> String {
+        let mut text = String::new();
+        for phase in &self.phases {
+            let _ = writeln!(
+                text,
+                "{}: {:<14} {:>10.3}ms {:>9} allocations {:>11} bytes peak \
+                 heap {:>11} peak rss",
+                label,
+                phase.name,
+                phase.time.as_secs_f64() * 1000.0,
+                phase.allocations,
+                phase.peak_heap,
+                phase
+                    .peak_rss
+                    .map_or("unknown".into(), |rss| format!("{} bytes", rss))
+            );
+        }
+        text
+    }
+
+    /// A single line of JSON with every phase, labeled with `label`.
+    pub fn to_json(&self, label: &str) -> String {
+        let phases = self
+            .phases
+            .iter()
+            .map(|phase| {
+                format!(
+                    "{{\"name\": \"{}\", \"seconds\": {}, \"allocations\": {}, \
+                     \"peak_heap_bytes\": {}, \"peak_rss_bytes\": {}}}",
+                    phase.name,
+                    phase.time.as_secs_f64(),
+                    phase.allocations,
+                    phase.peak_heap,
+                    phase
+                        .peak_rss
+                        .map_or("null".into(), |rss| rss.to_string())
+                )
+            })
+            .collect::<Vec<_>>()
+            .join(", ");
+        format!(
+            "{{\"file\": \"{}\", \"phases\": [{}]}}\n",
+            label.replace('\\', "\\\\").replace('"', "\\\""),
+            phases
+        )
+    }
+}
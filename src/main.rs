@@ -1,74 +1,398 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
 use pulsar_backend::{
-    calyx::{CalyxBackend, CalyxBackendInput},
+    calyx::{CalyxBackend, CalyxBackendInput, CalyxPasses},
+    cpp::CppBackend,
     Output, PulsarBackend
 };
-use pulsar_frontend::{
-    lexer::Lexer, parser::Parser, static_analysis::StaticAnalyzer
+use pulsar_frontend::{lexer::Lexer, parser::Parser};
+use pulsar_ir::{
+    cache::IrCache,
+    lower::{lower_program, WORKER_STACK_SIZE}
+};
+use pulsar_utils::{
+    error::ErrorManager,
+    id::Gen,
+    loc::Source,
+    stats::{CountingAllocator, Phases}
 };
-use pulsar_ir::generator::Generator;
-use pulsar_utils::{error::ErrorManager, loc::Source};
 use std::{
-    cell::RefCell, env, fs, io::stdout, path::PathBuf, process::Command, rc::Rc
+    cell::RefCell,
+    env, fs,
+    io::{stderr, stdout, Write},
+    path::{Path, PathBuf},
+    process::Command,
+    rc::Rc,
+    sync::atomic::{AtomicBool, AtomicUsize, Ordering},
+    thread
 };
 
-fn handle_errors(error_manager: Rc<RefCell<ErrorManager>>) -> Result<(), ()> {
+/// How many errors a compile reports before it stops recording them.
+const MAX_ERRORS: usize = 50;
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+fn handle_errors(
+    error_manager: Rc<RefCell<ErrorManager>>, diagnostics: &mut Vec<u8>
+) -> Result<(), ()> {
     if error_manager.borrow().has_errors() {
         error_manager
             .borrow_mut()
-            .consume_and_write(&mut stdout())
+            .consume_and_write(diagnostics)
             .map_err(|_| ())?;
         return Err(());
     }
     Ok(())
 }
 
-#[allow(clippy::result_unit_err)]
-pub fn main() -> Result<(), ()> {
-    let mut args = env::args();
-    args.next(); // ignore program path
-    let filename = args.next().unwrap_or("data/test.plsr".into());
-    let source = Source::file(
-        filename.clone(),
-        fs::read_to_string(filename).expect("Could not read file")
-    );
-
-    let error_manager = ErrorManager::with_max_count(50);
-
-    let lexer = Lexer::new(source, error_manager.clone());
-    let tokens: Vec<_> = lexer.into_iter().collect();
-    handle_errors(error_manager.clone())?;
-
-    let parser = Parser::new(tokens, error_manager.clone());
-    let program_ast: Vec<_> = parser.into_iter().collect();
-    handle_errors(error_manager.clone())?;
+/// Where the calyx root that `fud` reports is saved after the first lookup.
+fn calyx_root_cache() -> Option<PathBuf> {
+    let cache = match env::var_os("XDG_CACHE_HOME") {
+        Some(cache) => PathBuf::from(cache),
+        None => Path::new(&env::var_os("HOME")?).join(".cache")
+    };
+    Some(cache.join("pulsar").join("calyx-root"))
+}
 
-    let mut type_inferer = StaticAnalyzer::new(error_manager.clone());
-    let annotated_ast =
-        type_inferer.infer(program_ast).ok_or(()).map_err(|()| {
-            let _ = handle_errors(error_manager.clone());
-        })?;
-    handle_errors(error_manager)?;
+/// The calyx library path: `explicit` if given, then `$PULSAR_CALYX_LIB`, then
+/// the cached answer of `fud c global.root` while it still names a directory,
+/// and only otherwise `fud` itself, which costs a Python startup.
+fn calyx_root(explicit: Option<PathBuf>) -> PathBuf {
+    if let Some(root) =
+        explicit.or_else(|| env::var_os("PULSAR_CALYX_LIB").map(PathBuf::from))
+    {
+        return root;
+    }
 
-    let generator = Generator::new(annotated_ast);
-    let generated_code: Vec<_> = generator.into_iter().collect();
+    let cache = calyx_root_cache();
+    if let Some(root) = cache
+        .as_ref()
+        .and_then(|cache| fs::read_to_string(cache).ok())
+        .map(|root| PathBuf::from(root.trim()))
+        .filter(|root| root.is_dir())
+    {
+        return root;
+    }
 
     let command_output = Command::new("fud")
         .args(["c", "global.root"])
         .output()
         .expect("'fud' is not installed and/or misconfigured");
-    let calyx_root = String::from_utf8_lossy(&command_output.stdout)
+    let root = String::from_utf8_lossy(&command_output.stdout)
         .trim()
         .to_string();
+    if let (Some(cache), false) = (cache, root.is_empty()) {
+        // failing to save only costs the next compile another lookup
+        let _ = cache
+            .parent()
+            .map_or(Ok(()), fs::create_dir_all)
+            .and_then(|()| fs::write(&cache, &root));
+    }
+    PathBuf::from(root)
+}
+
+/// How the phases of a compile are reported.
+#[derive(Clone, Copy)]
+pub enum StatsFormat {
+    /// One line per phase, for `--time-passes` or `--stats=text`.
+    Text,
+    /// One line of JSON per compile, for `--stats=json`.
+    Json
+}
+
+/// What every file in one run of the compiler is compiled with.
+pub struct Options<'a> {
+    pub lib_path: PathBuf,
+    /// Functions whose IR is in the cache are not inferred or generated
+    /// again, so their warnings are only reported on the compile that cached
+    /// them.
+    pub cache: Option<&'a IrCache>,
+    /// Lowers each program on this many threads if given (see
+    /// [`lower_program`]), and on the thread compiling it otherwise.
+    pub threads: Option<usize>,
+    pub passes: CalyxPasses,
+    /// How to report where each compile spent its time and memory, if at
+    /// all. Nothing is measured otherwise, and a batch compile that is
+    /// measured runs one file at a time.
+    pub stats: Option<StatsFormat>,
+    /// Whether to print each calyx program to stderr before its passes run.
+    pub dump_calyx: bool
+}
+
+/// Compiles the program in `filename` to Verilog on `output` with `options`,
+/// writing the manifest of its top-level component to `manifest` and a C++
+/// model of it to `reference` if given. Diagnostics are collected in
+/// `diagnostics` so that concurrent compiles do not interleave. The phases of
+/// the compile are reported on stderr if `options.stats` asks for them.
+#[allow(clippy::result_unit_err)]
+pub fn compile(
+    filename: &str, options: &Options, output: Output,
+    manifest: Option<PathBuf>, reference: Option<PathBuf>,
+    diagnostics: &mut Vec<u8>
+) -> Result<(), ()> {
+    let mut phases = if options.stats.is_some() {
+        Phases::recording()
+    } else {
+        Phases::new()
+    };
+    let result = compile_phases(
+        filename,
+        options,
+        output,
+        manifest,
+        reference,
+        &mut phases,
+        diagnostics
+    );
+    let report = match options.stats {
+        Some(StatsFormat::Text) => phases.to_text(filename),
+        Some(StatsFormat::Json) => phases.to_json(filename),
+        None => String::new()
+    };
+    let _ = stderr().lock().write_all(report.as_bytes());
+    result
+}
+
+/// [`compile`], recording each phase in `phases` as it runs.
+fn compile_phases(
+    filename: &str, options: &Options, output: Output,
+    manifest: Option<PathBuf>, reference: Option<PathBuf>, phases: &mut Phases,
+    diagnostics: &mut Vec<u8>
+) -> Result<(), ()> {
+    // so that a program compiles the same way whatever was compiled before it
+    Gen::reset();
+
+    let source = phases.measure("read", || {
+        Source::file(
+            filename.to_string(),
+            fs::read_to_string(filename).expect("Could not read file")
+        )
+    });
+
+    let error_manager = ErrorManager::with_max_count(MAX_ERRORS);
+
+    let tokens = phases.measure("lex", || {
+        let lexer = Lexer::new(source, error_manager.clone());
+        lexer.into_iter().collect::<Vec<_>>()
+    });
+    handle_errors(error_manager.clone(), diagnostics)?;
+
+    let program_ast = phases.measure("parse", || {
+        let parser = Parser::new(tokens, error_manager.clone());
+        parser.into_iter().collect::<Vec<_>>()
+    });
+    handle_errors(error_manager.clone(), diagnostics)?;
+
+    let generated_code = lower_program(
+        program_ast,
+        options.cache,
+        options.threads,
+        &error_manager,
+        phases
+    )
+    .ok_or(())
+    .map_err(|()| {
+        let _ = handle_errors(error_manager.clone(), diagnostics);
+    })?;
+    handle_errors(error_manager.clone(), diagnostics)?;
+
+    if let Some(reference) = reference {
+        phases
+            .measure("reference", || {
+                CppBackend::new(error_manager.clone())
+                    .emit(&generated_code, Output::File(reference))
+            })
+            .map_err(|err| {
+                let _ = writeln!(diagnostics, "{:?}\n", err);
+            })?;
+        // a program without a reference model still has hardware, so this
+        // only warns
+        let _ = error_manager.borrow_mut().consume_and_write(diagnostics);
+    }
 
     let calyx_backend = CalyxBackend::new(CalyxBackendInput {
-        lib_path: PathBuf::from(calyx_root)
+        lib_path: options.lib_path.clone(),
+        manifest,
+        passes: options.passes,
+        dump: options.dump_calyx
     });
     calyx_backend
-        .run(generated_code, Output::Stdout)
+        .emit(generated_code, output, phases)
         .map_err(|err| {
-            println!("{:?}\n", err);
-        })?;
+            let _ = writeln!(diagnostics, "{:?}\n", err);
+        })
+}
 
-    Ok(())
+/// Compiles every file in `filenames` with `options` to `<out_dir>/<name>.sv`
+/// next to its manifest `<name>.json` and reference model `<name>.ref.h`, on
+/// up to `jobs` threads at once.
+fn compile_batch(
+    filenames: &[String], options: &Options, out_dir: &Path, jobs: usize
+) -> Result<(), ()> {
+    fs::create_dir_all(out_dir).expect("Could not create output directory");
+    let next = AtomicUsize::new(0);
+    let failed = AtomicBool::new(false);
+    thread::scope(|scope| {
+        for _ in 0..jobs.clamp(1, filenames.len().max(1)) {
+            let worker = || {
+                while let Some(filename) =
+                    filenames.get(next.fetch_add(1, Ordering::Relaxed))
+                {
+                    let name = Path::new(filename)
+                        .file_stem()
+                        .expect("Input file has no name");
+                    let path = out_dir.join(name);
+                    let mut diagnostics = vec![];
+                    if compile(
+                        filename,
+                        options,
+                        Output::File(path.with_extension("sv")),
+                        Some(path.with_extension("json")),
+                        Some(path.with_extension("ref.h")),
+                        &mut diagnostics
+                    )
+                    .is_err()
+                    {
+                        failed.store(true, Ordering::Relaxed);
+                    }
+                    let _ = stdout().lock().write_all(&diagnostics);
+                }
+            };
+            thread::Builder::new()
+                .stack_size(WORKER_STACK_SIZE)
+                .spawn_scoped(scope, worker)
+                .expect("Could not start a compile thread");
+        }
+    });
+    if failed.load(Ordering::Relaxed) {
+        Err(())
+    } else {
+        Ok(())
+    }
+}
+
+#[allow(clippy::result_unit_err)]
+pub fn main() -> Result<(), ()> {
+    let mut args = env::args();
+    args.next(); // ignore program path
+    let mut filenames = vec![];
+    let mut manifest = None;
+    let mut reference = None;
+    let mut calyx_lib = None;
+    let mut out_dir = None;
+    let mut jobs = None;
+    let mut cache_dir = None;
+    let mut threads = None;
+    let mut output = None;
+    let mut passes = CalyxPasses::default();
+    let mut stats = None;
+    let mut dump_calyx = false;
+    while let Some(arg) = args.next() {
+        match arg.as_str() {
+            "--calyx-lib" => {
+                calyx_lib = Some(PathBuf::from(
+                    args.next().expect("--calyx-lib requires a path")
+                ));
+            }
+            "--manifest" => {
+                manifest = Some(PathBuf::from(
+                    args.next().expect("--manifest requires a path")
+                ));
+            }
+            "--reference" => {
+                reference = Some(PathBuf::from(
+                    args.next().expect("--reference requires a path")
+                ));
+            }
+            "-o" | "--output" => {
+                output = Some(PathBuf::from(
+                    args.next().expect("--output requires a path")
+                ));
+            }
+            "--out-dir" => {
+                out_dir = Some(PathBuf::from(
+                    args.next().expect("--out-dir requires a path")
+                ));
+            }
+            "--cache-dir" => {
+                cache_dir = Some(PathBuf::from(
+                    args.next().expect("--cache-dir requires a path")
+                ));
+            }
+            "--threads" => {
+                threads = Some(
+                    args.next()
+                        .and_then(|threads| threads.parse::<usize>().ok())
+                        .expect("--threads requires a number")
+                );
+            }
+            "--passes" => {
+                passes = args
+                    .next()
+                    .expect("--passes requires 'fast' or 'full'")
+                    .parse()
+                    .unwrap_or_else(|err: String| panic!("{}", err));
+            }
+            "--time-passes" => stats = Some(StatsFormat::Text),
+            "--stats=text" => stats = Some(StatsFormat::Text),
+            "--stats=json" => stats = Some(StatsFormat::Json),
+            "--dump-calyx" => dump_calyx = true,
+            "-j" | "--jobs" => {
+                jobs = Some(
+                    args.next()
+                        .and_then(|jobs| jobs.parse::<usize>().ok())
+                        .expect("--jobs requires a number")
+                );
+            }
+            _ if arg.starts_with('-') => panic!("Unknown option '{}'", arg),
+            _ => filenames.push(arg)
+        }
+    }
+    if filenames.is_empty() {
+        filenames.push("data/test.plsr".into());
+    }
+    let cache = cache_dir.map(|dir| {
+        IrCache::new(dir).expect("Could not create cache directory")
+    });
+    let options = Options {
+        lib_path: calyx_root(calyx_lib),
+        cache: cache.as_ref(),
+        threads,
+        passes,
+        stats,
+        dump_calyx
+    };
+
+    if let Some(out_dir) = out_dir {
+        assert!(
+            manifest.is_none() && reference.is_none() && output.is_none(),
+            "--out-dir writes a manifest and reference next to each output \
+             instead"
+        );
+        // phases are measured process-wide, so measured compiles run alone
+        let jobs = if options.stats.is_some() {
+            1
+        } else {
+            jobs.unwrap_or_else(|| {
+                thread::available_parallelism().map_or(1, |jobs| jobs.get())
+            })
+        };
+        return compile_batch(&filenames, &options, &out_dir, jobs);
+    }
+
+    assert!(
+        filenames.len() == 1,
+        "Compiling several files requires --out-dir"
+    );
+    let mut diagnostics = vec![];
+    let result = compile(
+        &filenames[0],
+        &options,
+        output.map_or(Output::Stdout, Output::File),
+        manifest,
+        reference,
+        &mut diagnostics
+    );
+    let _ = stdout().write_all(&diagnostics);
+    result
 }
@@ -1,54 +1,171 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
-#ifdef PULSAR_VERILATOR_TEST
-    #include <iostream>
+#include "harness.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
 
-void PulsarMain::cycle() {
-    mod->clk = 0;
-    mod->eval();
-    mod->clk = 1;
-    mod->eval();
+void PulsarStats::fail(size_t invocation) {
+    if (failed_at == UINT64_MAX && invocation < starts.size()) {
+        failed_at = starts[invocation];
+    }
 }
-void PulsarMain::pump() {
-    for (int i = 0; i < 10; i++) {
-        cycle();
+
+#ifndef PULSAR_CHECK_REPORTED
+    #define PULSAR_CHECK_REPORTED 10
+#endif
+size_t PulsarStats::check(const int64_t* args, const int64_t* expected,
+    const int64_t* received, size_t length) {
+    std::vector<size_t> mismatches =
+        pulsar_mismatches(expected, received, length);
+    if (mismatches.empty()) {
+        return 0;
     }
+    size_t first = starts.size() >= length ? starts.size() - length : 0;
+    for (size_t i = 0; i < mismatches.size() && i < PULSAR_CHECK_REPORTED;
+         i++) {
+        size_t j = mismatches[i];
+        std::cout << "test failed: expected: " << expected[j]
+                  << " but received: " << received[j] << " on input "
+                  << args[j] << " (invocation " << first + j << ")" << '\n';
+    }
+    std::cout << mismatches.size() << " of " << length
+              << " results differ, rerun with +seed=" << seed
+              << " to reproduce" << '\n';
+    fail(first + mismatches[0]);
+    return mismatches.size();
 }
-void PulsarMain::reset() {
-    mod->reset = 1;
-    pump();
-    mod->reset = 0;
-    pump();
+
+void PulsarStats::dump_stats(std::ostream& out) const {
+    std::vector<uint64_t> sorted(latencies);
+    std::sort(sorted.begin(), sorted.end());
+    std::map<uint64_t, uint64_t> histogram;
+    uint64_t total = 0;
+    for (uint64_t latency : sorted) {
+        histogram[latency]++;
+        total += latency;
+    }
+    // nearest-rank percentile over the sorted latencies
+    auto percentile = [&](size_t p) -> uint64_t {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t rank = (p * sorted.size() + 99) / 100;
+        return sorted[rank == 0 ? 0 : rank - 1];
+    };
+    out << "{\"invocations\": " << sorted.size() << ", \"cycles\": " << cycles
+        << ", \"latency\": {";
+    if (!sorted.empty()) {
+        out << "\"min\": " << sorted.front() << ", \"max\": " << sorted.back()
+            << ", \"mean\": " << (double)total / sorted.size()
+            << ", \"p50\": " << percentile(50)
+            << ", \"p99\": " << percentile(99) << ", ";
+    }
+    out << "\"histogram\": {";
+    bool first = true;
+    for (const auto& bucket : histogram) {
+        out << (first ? "" : ", ") << '"' << bucket.first
+            << "\": " << bucket.second;
+        first = false;
+    }
+    out << "}}}" << '\n';
 }
-void PulsarMain::go() {
-    mod->go = 1;
-    while (!mod->done) {
-        cycle();
+
+const char* pulsar_plusarg(int argc, char** argv, const char* name) {
+    size_t length = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '+' || strncmp(argv[i] + 1, name, length) != 0) {
+            continue;
+        }
+        const char* rest = argv[i] + 1 + length;
+        if (*rest == '=') {
+            return rest + 1;
+        } else if (*rest == '\0') {
+            return rest;
+        }
     }
-    mod->go = 0;
-    cycle();
+    return nullptr;
 }
 
-    #ifdef __linux__
-// linux hack for CI?
-// https://veripool.org/guide/latest/faq.html#why-do-i-get-undefined-reference-to-sc-time-stamp
-// likely not sustainable
-double sc_time_stamp() {
-    return 0;
+static const char* getenv_or(const char* name, const char* fallback) {
+    const char* value = getenv(name);
+    return value ? value : fallback;
 }
-    #endif
 
-int test(PulsarMain main);
+// Writes how long building the model and running it took to stderr as a JSON
+// line. invoke.bash passes the build time, which the model cannot see itself.
+static void report_time(double simulation_seconds) {
+    const char* build_seconds = getenv("PULSAR_BUILD_SECONDS");
+    std::cerr << "{\"design\": \"" << getenv_or("PULSAR_DESIGN", "unknown")
+              << "\", \"build_seconds\": "
+              << (build_seconds && *build_seconds ? build_seconds : "null")
+              << ", \"cached\": "
+              << (getenv("PULSAR_BUILD_CACHED") ? "true" : "false")
+              << ", \"simulation_seconds\": " << simulation_seconds << "}"
+              << '\n';
+}
 
-int main(int argc, char** argv) {
-    Verilated::commandArgs(argc, argv);
-    VPULSAR_MAIN_MODULE* mod = new VPULSAR_MAIN_MODULE;
-    PulsarMain main;
-    main.mod = mod;
-    int exit_code = test(main);
-    if (exit_code == 0) {
-        std::cout << "test passed!" << '\n';
+#ifndef PULSAR_TRACE_WINDOW
+    #define PULSAR_TRACE_WINDOW 100
+#endif
+int pulsar_run_design(int argc, char** argv, PulsarRunModel run_model,
+    bool traceable) {
+    PulsarRun run;
+    const char* seed = pulsar_plusarg(argc, argv, "seed");
+    run.seed = seed
+                   ? strtoull(seed, nullptr, 10)
+                   : std::chrono::system_clock::now().time_since_epoch().count();
+    auto start = std::chrono::steady_clock::now();
+    int exit_code = run_model(argc, argv, run);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const char* time = getenv("PULSAR_TIME");
+    if (time && *time) {
+        report_time(elapsed.count());
     }
-    delete mod;
-    exit(exit_code);
+    const char* trace_path = pulsar_plusarg(argc, argv, "trace");
+    if (exit_code != 0 && trace_path && traceable) {
+        const char* window_arg = pulsar_plusarg(argc, argv, "trace_window");
+        uint64_t window = window_arg ? strtoull(window_arg, nullptr, 10)
+                                     : PULSAR_TRACE_WINDOW;
+        uint64_t center =
+            run.failed_at != UINT64_MAX ? run.failed_at : run.end_cycle;
+        uint64_t begin = center > window ? center - window : 0;
+        PulsarRun replay;
+        replay.seed = run.seed;
+        replay.trace_path = *trace_path ? trace_path : "trace.fst";
+        replay.trace_begin = 2 * begin;
+        replay.trace_end = 2 * (center + window);
+        run_model(argc, argv, replay);
+        std::cout << "trace: wrote cycles " << begin << " to "
+                  << center + window << " of seed " << run.seed << " to "
+                  << replay.trace_path << '\n';
+    }
+    return exit_code;
+}
+
+int pulsar_report_bench(const PulsarBench& bench) {
+    std::ofstream file;
+    const char* output = getenv("PULSAR_BENCH_OUTPUT");
+    if (output) {
+        file.open(output, std::ios::app);
+        if (!file) {
+            std::cerr << "bench: could not open " << output << '\n';
+            return 1;
+        }
+    }
+    std::ostream& out = output ? file : std::cout;
+    out << "{\"design\": \"" << getenv_or("PULSAR_DESIGN", "unknown")
+        << "\", \"revision\": \"" << getenv_or("PULSAR_REVISION", "unknown")
+        << "\", \"threads\": " << bench.threads << ", \"schedule\": \""
+        << bench.schedule << "\", \"warmup\": " << bench.warmup
+        << ", \"invocations\": " << bench.invocations
+        << ", \"cycles\": " << bench.cycles
+        << ", \"seconds\": " << bench.seconds
+        << ", \"cycles_per_second\": " << bench.cycles / bench.seconds
+        << ", \"invocations_per_second\": "
+        << bench.invocations / bench.seconds << "}" << '\n';
+    return 0;
 }
-#endif
@@ -0,0 +1,108 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+// The parts of the harness that do not depend on a design. harness.cpp builds
+// them once into a library that the model of every design links against, so
+// only the model and the code in model.cpp are compiled for each design.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// What a model records about the invocations it has run, and what a test has
+// found wrong with them.
+struct PulsarStats {
+    // Every call to `cycle()` since construction.
+    uint64_t cycles = 0;
+
+    // The cycles each invocation took, from `go` to `done`.
+    std::vector<uint64_t> latencies;
+
+    // The cycle each invocation started on.
+    std::vector<uint64_t> starts;
+
+    // The cycle that the first invocation passed to `fail` started on.
+    uint64_t failed_at = UINT64_MAX;
+
+    // Seeds all randomized testing, taken from `+seed=<n>` when given.
+    uint64_t seed = 0;
+
+    // Marks `invocation` as having produced the wrong result, so that a
+    // `+trace` replay captures the cycles around it.
+    void fail(size_t invocation);
+
+    // Compares the results of the last `length` invocations in `received`
+    // against `expected` in bulk. Only mismatches are formatted: the first
+    // few are written to `std::cout` with their arguments and the seed, and
+    // the first is passed to `fail`. Returns how many there were.
+    size_t check(const int64_t* args, const int64_t* expected,
+        const int64_t* received, size_t length);
+
+    // Writes the cycle count and a summary and histogram of `latencies` to
+    // `out` as a single JSON object.
+    void dump_stats(std::ostream& out) const;
+};
+
+// The indices of the first `limit` elements where `received` differs from
+// `expected`. They are counted in a branch-free pass first, so results that
+// all match cost a single vectorized comparison.
+inline std::vector<size_t> pulsar_mismatches(const int64_t* expected,
+    const int64_t* received, size_t length, size_t limit = SIZE_MAX) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        count += expected[i] != received[i];
+    }
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < length && indices.size() < std::min(count, limit);
+         i++) {
+        if (expected[i] != received[i]) {
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+// What a single run of a design starts from and leaves behind.
+struct PulsarRun {
+    uint64_t seed = 0;
+    // if set, the time slots in [`trace_begin`, `trace_end`] are written here
+    const char* trace_path = nullptr;
+    uint64_t trace_begin = 0;
+    uint64_t trace_end = 0;
+    // the first cycle of the invocation the test reported with `fail`
+    uint64_t failed_at = UINT64_MAX;
+    uint64_t end_cycle = 0;
+};
+
+// Runs the test, or the benchmark, of a design against a freshly constructed
+// model, filling in what `run` leaves behind. Returns the exit code.
+using PulsarRunModel = int (*)(int argc, char** argv, PulsarRun& run);
+
+// The value of `+<name>=<value>` in `argv`, the empty string for a bare
+// `+<name>`, or null if neither was passed.
+const char* pulsar_plusarg(int argc, char** argv, const char* name);
+
+// Runs the design once with `run_model`, and if it fails with
+// `+trace[=<path>]` passed to a model built with `traceable`, again from the
+// same seed while writing the `+trace_window=<n>` cycles on either side of
+// the first mismatch to an FST file. Passing runs never trace. If
+// `$PULSAR_TIME` is non-empty, how long the first run took, and how long
+// building the model took if `$PULSAR_BUILD_SECONDS` gives it, is written to
+// stderr as a JSON line.
+int pulsar_run_design(int argc, char** argv, PulsarRunModel run_model,
+    bool traceable);
+
+// One timed stretch of back-to-back invocations of a design.
+struct PulsarBench {
+    unsigned threads = 1;
+    // "static" if the manifest gives the latency, otherwise "dynamic"
+    const char* schedule = "dynamic";
+    uint64_t warmup = 0;
+    uint64_t invocations = 0;
+    uint64_t cycles = 0;
+    double seconds = 0;
+};
+
+// Appends `bench` as a JSON line to `$PULSAR_BENCH_OUTPUT`, or stdout if it
+// is unset, labeled with `$PULSAR_DESIGN` and `$PULSAR_REVISION`. Returns the
+// exit code.
+int pulsar_report_bench(const PulsarBench& bench);
@@ -1,25 +1,150 @@
 #!/bin/bash
-# REQUIRED INPUT $1 = name of build subdirectory
-# REQUIRED INPUT $2 = name of top-level module 
+# REQUIRED INPUT $1 = name of build subdirectory, which holds the design
+#                     $1.sv and the header $1.h written with its manifest
+# REQUIRED ENV PULSAR_HARNESS = path to the harness library, which `make`
+#                     builds from harness/harness.cpp for the same flags
+# OPTIONAL INPUT $2 = name of top-level module, read from $1.h by default
+# OPTIONAL ENV PULSAR_CFLAGS = extra flags for compiling the harness
+# OPTIONAL ENV CXX = C++ compiler that builds the model, c++ by default
+# OPTIONAL ENV PULSAR_NO_CACHE = rebuild even if a cached model exists
+# OPTIONAL ENV THREADS = number of threads to verilate the model for
+# OPTIONAL ENV PULSAR_ARGS = plusargs passed to the model, e.g. +seed=<n>
+# OPTIONAL ENV TRACE = build the model with FST tracing support
+# OPTIONAL ENV SAVABLE = build the model with --savable so resets are restored
+# OPTIONAL ENV PROFILE = debug (the default), fast, or pgo; see below
+# OPTIONAL ENV PULSAR_TIME = report how long building and simulating the model
+#                     took as a JSON line on stderr
 
 set -x
 
 BUILD_DIR="build"
+CACHE_DIR="$BUILD_DIR/cache"
+CXX="${CXX:-c++}"
 N="$1"
-MOD="$2"
+MANIFEST="$BUILD_DIR/$N/$N.h"
+MOD="${2:-$(sed -n 's/^ *#define PULSAR_TOP_MODULE "\(.*\)"$/\1/p' "$MANIFEST")}"
 
 if [[ "$(uname -s)" == "Darwin" ]]; then
     NUM_CORES=$(sysctl -n hw.logicalcpu)
-    SED="sed -i ''"
+    SHA="shasum -a 256"
 else
     NUM_CORES=$(nproc)
-    SED="sed -i"
+    SHA="sha256sum"
 fi
 
-$SED "s/PULSAR_MAIN_MODULE/$MOD/g" "$BUILD_DIR/$N/sim_main.cpp"
-cd "$BUILD_DIR/$N" && verilator \
-    --cc --exe -sv --build -j "$NUM_CORES" \
-    --top-module $MOD \
-    -CFLAGS "-DHARNESS -DPULSAR_VERILATOR_TEST -I../../../phony" \
-    sim_main.cpp "$N.sv" \
-    && "obj_dir/V$MOD"
+# the only part of the harness that depends on the model's name
+printf '%s\n' "// Generated by invoke.bash. Do not edit." "#include \"V$MOD.h\"" \
+    "using PulsarModule = V$MOD;" > "$BUILD_DIR/$N/adapter.h"
+
+# everything else that does not depend on the design is compiled once
+LIBRARY="$PULSAR_HARNESS"
+if [[ ! -f "$LIBRARY" ]]; then
+    echo "invoke.bash: missing $LIBRARY, build it with make" >&2
+    exit 1
+fi
+# absolute, since the model is built from inside the design's directory
+LIBRARY="$(cd "$(dirname "$LIBRARY")" && pwd)/$(basename "$LIBRARY")"
+
+if [[ -n "$THREADS" ]]; then
+    THREAD_FLAGS="--threads $THREADS"
+    PULSAR_CFLAGS="$PULSAR_CFLAGS -DPULSAR_THREADS=$THREADS"
+fi
+
+if [[ -n "$TRACE" ]]; then
+    TRACE_FLAGS="--trace-fst"
+    PULSAR_CFLAGS="$PULSAR_CFLAGS -DPULSAR_TRACE"
+fi
+
+if [[ -n "$SAVABLE" ]]; then
+    SAVABLE_FLAGS="--savable"
+    PULSAR_CFLAGS="$PULSAR_CFLAGS -DPULSAR_SAVABLE"
+fi
+
+# memories on the top-level component are accessed through VPI, which costs
+# simulation speed, so only designs that have them pay for it
+if grep -q '^ *#define PULSAR_MEMORIES [1-9]' "$MANIFEST"; then
+    VPI_FLAGS="--vpi --public-flat-rw"
+    PULSAR_CFLAGS="$PULSAR_CFLAGS -DPULSAR_VPI"
+fi
+
+# debug keeps Verilator's and the compiler's defaults. fast optimizes the
+# model for speed on this machine at the cost of build time and of X values
+# being resolved arbitrarily. pgo builds fast with instrumentation, runs it
+# once to train (on whatever the Makefile runs, e.g. the benchmark), and then
+# builds it again from the profiles, which only GCC's -fprofile-use reads.
+case "${PROFILE:=debug}" in
+    debug)
+        ;;
+    fast | pgo)
+        PROFILE_FLAGS="-O3 --x-assign fast --x-initial fast"
+        PROFILE_CFLAGS="-O3 -march=native"
+        ;;
+    *)
+        echo "invoke.bash: unknown PROFILE '$PROFILE'" >&2
+        exit 1
+        ;;
+esac
+
+# Verilated models are cached by everything that goes into building them:
+# the design, the harness library and test sources, the flags, and the
+# toolchain, i.e., Verilator and the C++ compiler it builds with.
+KEY=$( (
+    cat "$BUILD_DIR/$N/$N.sv" "$BUILD_DIR/$N/sim_main.cpp" \
+        "$BUILD_DIR/$N/adapter.h" "$LIBRARY" "$0"
+    echo "$PULSAR_CFLAGS $PROFILE"
+    verilator --version
+    "$CXX" --version
+) | $SHA | cut -d ' ' -f 1)
+CACHED="$CACHE_DIR/$KEY/V$MOD"
+
+if [[ -z "$PULSAR_NO_CACHE" && -x "$CACHED" ]]; then
+    (cd "$BUILD_DIR/$N" && PULSAR_DESIGN="$N" PULSAR_BUILD_SECONDS=0 \
+        PULSAR_BUILD_CACHED=1 "../../$CACHED" $PULSAR_ARGS)
+    exit $?
+fi
+
+# seconds since the epoch, as precisely as the shell can tell
+now() {
+    if [[ -n "$EPOCHREALTIME" ]]; then
+        echo "${EPOCHREALTIME/,/.}"
+    else
+        date +%s
+    fi
+}
+BUILD_START=$(now)
+
+verilate() {
+    (cd "$BUILD_DIR/$N" && verilator \
+        --cc --exe -sv --build -j "$NUM_CORES" $THREAD_FLAGS $VPI_FLAGS $TRACE_FLAGS $SAVABLE_FLAGS \
+        $PROFILE_FLAGS --top-module $MOD -MAKEFLAGS "CXX=$CXX" \
+        -CFLAGS "-DHARNESS -DPULSAR_VERILATOR_TEST -I../../../phony $PULSAR_CFLAGS $PROFILE_CFLAGS" \
+        "$@" sim_main.cpp "$LIBRARY" "$N.sv")
+}
+
+if [[ "$PROFILE" == "pgo" ]]; then
+    # Verilator only profiles the scheduling of threaded models
+    verilate ${THREADS:+--prof-pgo} \
+        -CFLAGS -fprofile-generate -LDFLAGS -fprofile-generate || exit $?
+    # the training run may fail a test and still profile it, and its own
+    # benchmark results are not kept
+    (cd "$BUILD_DIR/$N" && PULSAR_DESIGN="$N" PULSAR_BENCH_OUTPUT=/dev/null \
+        "obj_dir/V$MOD" $PULSAR_ARGS > /dev/null)
+    # keep the .gcda profiles but rebuild every object from them
+    find "$BUILD_DIR/$N/obj_dir" -name "*.o" -delete
+    rm -f "$BUILD_DIR/$N/obj_dir/V$MOD"
+    verilate $([[ -f "$BUILD_DIR/$N/profile.vlt" ]] && echo profile.vlt) \
+        -CFLAGS "-fprofile-use -fprofile-correction -Wno-missing-profile" \
+        || exit $?
+else
+    verilate || exit $?
+fi
+
+BUILD_SECONDS=$(awk -v start="$BUILD_START" -v end="$(now)" \
+    'BEGIN { print end - start }')
+
+# copy then rename so concurrent builds never run a partially written model
+mkdir -p "$CACHE_DIR/$KEY"
+cp "$BUILD_DIR/$N/obj_dir/V$MOD" "$CACHED.$$" && mv "$CACHED.$$" "$CACHED"
+
+cd "$BUILD_DIR/$N" && PULSAR_DESIGN="$N" PULSAR_BUILD_SECONDS="$BUILD_SECONDS" \
+    "obj_dir/V$MOD" $PULSAR_ARGS
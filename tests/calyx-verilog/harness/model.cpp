@@ -0,0 +1,495 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+// The parts of the harness that drive the model of one design, compiled with
+// it. Everything else is in the library harness.cpp builds.
+#ifdef PULSAR_VERILATOR_TEST
+    #include <chrono>
+    #include <cstdlib>
+    #include <iostream>
+    #include <memory>
+    #include <thread>
+    #include <string>
+    #ifdef PULSAR_VPI
+        #include "verilated_vpi.h"
+    #endif
+    #ifdef PULSAR_SAVABLE
+        #include <cstdio>
+        #include <unistd.h>
+    #endif
+
+PulsarMain::PulsarMain(uint64_t seed, bool trace)
+    : context(new VerilatedContext) {
+    this->seed = seed;
+    // the context is configured before any model is built on it
+    #ifdef PULSAR_THREADS
+    // must match the --threads the model was verilated with
+    context->threads(PULSAR_THREADS);
+    #endif
+    #ifdef PULSAR_TRACE
+    context->traceEverOn(trace);
+    #else
+    (void)trace;
+    #endif
+    mod.reset(new Module(context.get()));
+}
+PulsarMain::~PulsarMain() {
+    // `mod` is declared after `context`, so it is destroyed first
+    if (mod) {
+        mod->final();
+    }
+}
+PulsarMain PulsarMain::fork() const {
+    PulsarMain copy(seed);
+    copy.reset_cycles = reset_cycles;
+    #ifdef PULSAR_SAVABLE
+    // the copy restores the state this instance was reset to
+    if (reset_saved) {
+        copy.reset_snapshot = reset_snapshot;
+        copy.reset_saved = true;
+    }
+    #endif
+    return copy;
+}
+    #ifdef PULSAR_TRACE
+void PulsarMain::dump() {
+    uint64_t time = context->time();
+    if (trace && time >= trace_begin && time <= trace_end) {
+        trace->dump(time);
+    }
+}
+    #endif
+void PulsarMain::cycle() {
+    mod->clk = 0;
+    mod->eval();
+    #ifdef PULSAR_TRACE
+    // each half-cycle is its own time slot in the waveform
+    context->timeInc(1);
+    dump();
+    #endif
+    mod->clk = 1;
+    mod->eval();
+    #ifdef PULSAR_TRACE
+    context->timeInc(1);
+    dump();
+    #endif
+    cycles++;
+}
+void PulsarMain::pump() {
+    for (int i = 0; i < 10; i++) {
+        cycle();
+    }
+}
+void PulsarMain::reset() {
+    #ifdef PULSAR_SAVABLE
+    if (reset_saved) {
+        restore(reset_snapshot.c_str());
+        return;
+    }
+    #endif
+    mod->reset = 1;
+    for (size_t i = 0; i < reset_cycles; i++) {
+        cycle();
+    }
+    mod->reset = 0;
+    pump();
+    #ifdef PULSAR_SAVABLE
+    if (!reset_snapshot.empty()) {
+        save(reset_snapshot.c_str());
+        reset_saved = true;
+    }
+    #endif
+}
+    #ifdef PULSAR_SAVABLE
+void PulsarMain::save(const char* path) {
+    VerilatedSave os;
+    os.open(path);
+    if (!os.isOpen()) {
+        std::cerr << "harness: could not save to " << path << '\n';
+        exit(1);
+    }
+    os << *mod;
+}
+void PulsarMain::restore(const char* path) {
+    VerilatedRestore os;
+    os.open(path);
+    if (!os.isOpen()) {
+        std::cerr << "harness: could not restore from " << path << '\n';
+        exit(1);
+    }
+    // the context keeps its own time, so it stays monotonic across restores
+    os >> *mod;
+}
+    #endif
+    #ifdef PULSAR_STATIC_LATENCY
+// The manifest reports how many cycles the design takes, so `done` is only
+// read to check that it arrives on schedule.
+void PulsarMain::await_done() {
+    for (uint64_t i = 1; i <= PULSAR_STATIC_LATENCY; i++) {
+        cycle();
+        #ifdef PULSAR_CHECK_SCHEDULE
+        if (bool(mod->done) != (i == PULSAR_STATIC_LATENCY)) {
+            std::cerr << "harness: invocation " << starts.size()
+                      << (mod->done ? " was done" : " was not done")
+                      << " after " << i << " of " << PULSAR_STATIC_LATENCY
+                      << " scheduled cycles\n";
+            exit(1);
+        }
+        #endif
+    }
+}
+    #else
+void PulsarMain::await_done() {
+    while (!mod->done) {
+        cycle();
+    }
+}
+    #endif
+void PulsarMain::go() {
+    uint64_t start = cycles;
+    mod->go = 1;
+    await_done();
+    latencies.push_back(cycles - start);
+    starts.push_back(start);
+    mod->go = 0;
+    cycle();
+}
+template <typename Args, typename Bind, typename Read>
+uint64_t PulsarMain::run_batch(const Args* args, int64_t* rets, size_t count,
+    Bind bind, Read read) {
+    uint64_t batch_start = cycles;
+    if (count == 0) {
+        return 0;
+    }
+    bind(mod.get(), args[0]);
+    mod->go = 1;
+    // every invocation after the first starts on the edge leaving the
+    // previous `done`, so that edge is counted toward its latency
+    uint64_t start = cycles;
+    for (size_t i = 0; i < count; i++) {
+        await_done();
+        latencies.push_back(cycles - start);
+        starts.push_back(start);
+        rets[i] = read(mod.get());
+        // the edge leaving `done` restarts the design if `go` is still high,
+        // so the next argument must be in place before it
+        if (i + 1 < count) {
+            bind(mod.get(), args[i + 1]);
+        }
+        start = cycles;
+        if (i + 1 == count) {
+            mod->go = 0;
+        }
+    #ifdef PULSAR_STATIC_LATENCY
+        // the edge leaving `done` is the first of the next invocation's
+        // scheduled cycles, so only the last invocation idles after it
+        if (i + 1 == count) {
+            cycle();
+        }
+    #else
+        cycle();
+    #endif
+    }
+    return cycles - batch_start;
+}
+    #ifndef PULSAR_STREAM_STALL
+        #define PULSAR_STREAM_STALL 10000
+    #endif
+template <typename Ports>
+void PulsarStream<Ports>::step() {
+    bool offering = !input.empty();
+    Ports::offer(plsr.mod.get(), offering, offering ? input.front() : 0);
+    bool accepting = !output.full();
+    Ports::accept(plsr.mod.get(), accepting);
+    // ready and valid may answer the inputs just set, so they are settled
+    // and sampled before the edge that acts on them
+    plsr.mod->eval();
+    bool taken = offering && Ports::ready(plsr.mod.get());
+    bool given = accepting && Ports::valid(plsr.mod.get());
+    int64_t data = given ? Ports::data(plsr.mod.get()) : 0;
+    plsr.cycle();
+    cycles++;
+    if (taken) {
+        input.pop();
+        consumed++;
+    }
+    if (given) {
+        output.push(data);
+        produced++;
+    }
+}
+template <typename Ports>
+uint64_t PulsarStream<Ports>::run(const int64_t* in, int64_t* out,
+    size_t count) {
+    uint64_t start = cycles;
+    uint64_t stalled = 0;
+    size_t fed = 0;
+    size_t drained = 0;
+    while (drained < count) {
+        while (fed < count && !input.full()) {
+            input.push(in[fed++]);
+        }
+        uint64_t moved = consumed + produced;
+        step();
+        while (!output.empty() && drained < count) {
+            out[drained++] = output.front();
+            output.pop();
+        }
+        stalled = consumed + produced == moved ? stalled + 1 : 0;
+        if (stalled == PULSAR_STREAM_STALL) {
+            std::cerr << "harness: stream stalled for " << stalled
+                      << " cycles after " << drained << " of " << count
+                      << " elements\n";
+            exit(1);
+        }
+    }
+    Ports::offer(plsr.mod.get(), false, 0);
+    return cycles - start;
+}
+template <typename Ports>
+void PulsarStream<Ports>::dump_stats(std::ostream& out) const {
+    out << "{\"consumed\": " << consumed << ", \"produced\": " << produced
+        << ", \"cycles\": " << cycles << ", \"elements_per_cycle\": "
+        << (cycles ? double(produced) / cycles : 0.0) << "}" << '\n';
+}
+    #ifndef PULSAR_FUZZ_BLOCK
+        #define PULSAR_FUZZ_BLOCK 4096
+    #endif
+template <typename Bind, typename Read>
+std::vector<PulsarFailure> PulsarMain::fuzz(size_t count, int64_t min,
+    int64_t max, Reference reference, Bind bind, Read read) {
+    size_t shards = std::thread::hardware_concurrency();
+    if (const char* value = getenv("PULSAR_FUZZ_SHARDS")) {
+        shards = strtoul(value, nullptr, 10);
+    }
+    // shards run whole blocks, so every argument is the same whatever the
+    // shard count
+    size_t blocks = (count + PULSAR_FUZZ_BLOCK - 1) / PULSAR_FUZZ_BLOCK;
+    shards = std::max<size_t>(1, std::min(shards, blocks));
+
+    std::vector<std::vector<PulsarFailure>> failures(shards);
+    std::vector<uint64_t> shard_cycles(shards);
+    std::vector<std::vector<uint64_t>> shard_latencies(shards);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < shards; i++) {
+        threads.emplace_back([&, i] {
+            size_t first_block = blocks * i / shards;
+            size_t last_block = blocks * (i + 1) / shards;
+            size_t begin = first_block * PULSAR_FUZZ_BLOCK;
+            size_t end = std::min(count, last_block * PULSAR_FUZZ_BLOCK);
+            std::vector<int64_t> args(end - begin);
+            std::vector<int64_t> expected(args.size());
+            std::vector<int64_t> rets(args.size());
+            for (size_t block = first_block; block < last_block; block++) {
+                size_t offset = (block - first_block) * PULSAR_FUZZ_BLOCK;
+                size_t length =
+                    std::min<size_t>(PULSAR_FUZZ_BLOCK, args.size() - offset);
+                PulsarRandom(seed, block).fill_golden(args.data() + offset,
+                    expected.data() + offset, length, min, max, reference);
+            }
+
+            // the runtime is only thread-safe across distinct contexts, so
+            // each shard builds and tears down its own on its thread
+            PulsarMain shard = fork();
+            shard.reset();
+            shard.run_batch(args.data(), rets.data(), args.size(), bind,
+                read);
+
+            for (size_t j : pulsar_mismatches(
+                     expected.data(), rets.data(), rets.size())) {
+                failures[i].push_back(
+                    {i, begin + j, args[j], expected[j], rets[j]});
+            }
+            shard_cycles[i] = shard.cycles;
+            shard_latencies[i] = std::move(shard.latencies);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<PulsarFailure> result;
+    for (size_t i = 0; i < shards; i++) {
+        result.insert(result.end(), failures[i].begin(), failures[i].end());
+        cycles += shard_cycles[i];
+        latencies.insert(latencies.end(), shard_latencies[i].begin(),
+            shard_latencies[i].end());
+    }
+    return result;
+}
+    #ifdef PULSAR_VPI
+// The handle to the array inside the memory `name`, which must hold `length`
+// elements.
+static vpiHandle memory_handle(VerilatedContext* context, const char* name,
+    size_t length) {
+    // every model registers its scopes with its own context
+    Verilated::threadContextp(context);
+    std::string path = std::string("TOP.") + PULSAR_TOP_MODULE + "." + name
+                       + ".mem";
+    vpiHandle memory = vpi_handle_by_name((PLI_BYTE8*)path.c_str(), nullptr);
+    if (!memory) {
+        std::cerr << "harness: no memory " << path << '\n';
+        exit(1);
+    }
+    size_t size = vpi_get(vpiSize, memory);
+    if (size != length) {
+        std::cerr << "harness: memory " << name << " holds " << size
+                  << " elements but " << length << " were given" << '\n';
+        exit(1);
+    }
+    return memory;
+}
+void PulsarMain::write_memory(const char* name, const int64_t* data,
+    size_t length) {
+    vpiHandle memory = memory_handle(context.get(), name, length);
+    for (size_t i = 0; i < length; i++) {
+        vpiHandle word = vpi_handle_by_index(memory, (PLI_INT32)i);
+        s_vpi_vecval vector[2] = {};
+        vector[0].aval = (PLI_INT32)(uint64_t)data[i];
+        vector[1].aval = (PLI_INT32)((uint64_t)data[i] >> 32);
+        s_vpi_value value;
+        value.format = vpiVectorVal;
+        value.value.vector = vector;
+        vpi_put_value(word, &value, nullptr, vpiNoDelay);
+        vpi_release_handle(word);
+    }
+    vpi_release_handle(memory);
+}
+void PulsarMain::read_memory(const char* name, int64_t* data,
+    size_t length) {
+    vpiHandle memory = memory_handle(context.get(), name, length);
+    for (size_t i = 0; i < length; i++) {
+        vpiHandle word = vpi_handle_by_index(memory, (PLI_INT32)i);
+        s_vpi_value value;
+        value.format = vpiVectorVal;
+        vpi_get_value(word, &value);
+        uint64_t low = (uint32_t)value.value.vector[0].aval;
+        uint64_t high = (uint32_t)value.value.vector[1].aval;
+        data[i] = (int64_t)(low | high << 32);
+        vpi_release_handle(word);
+    }
+    vpi_release_handle(memory);
+}
+    #else
+void PulsarMain::write_memory(const char* name, const int64_t*, size_t) {
+    std::cerr << "harness: cannot write " << name
+              << ", the design has no memories" << '\n';
+    exit(1);
+}
+void PulsarMain::read_memory(const char* name, int64_t*, size_t) {
+    std::cerr << "harness: cannot read " << name
+              << ", the design has no memories" << '\n';
+    exit(1);
+}
+    #endif
+
+    #if defined(__linux__) && !defined(PULSAR_RUNNER)
+// linux hack for CI?
+// https://veripool.org/guide/latest/faq.html#why-do-i-get-undefined-reference-to-sc-time-stamp
+// likely not sustainable
+double sc_time_stamp() {
+    return 0;
+}
+    #endif
+
+    #ifdef PULSAR_BENCH
+        #ifndef PULSAR_BENCH_WARMUP
+            #define PULSAR_BENCH_WARMUP 100
+        #endif
+        #ifndef PULSAR_BENCH_INVOCATIONS
+            #define PULSAR_BENCH_INVOCATIONS 10000
+        #endif
+
+// Times `PULSAR_BENCH_INVOCATIONS` back-to-back `go()`s after
+// `PULSAR_BENCH_WARMUP` untimed ones and reports them with
+// `pulsar_report_bench`.
+static int bench(PulsarMain& main) {
+    main.reset();
+    for (int i = 0; i < PULSAR_BENCH_WARMUP; i++) {
+        main.go();
+    }
+    uint64_t start_cycles = main.cycles;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PULSAR_BENCH_INVOCATIONS; i++) {
+        main.go();
+    }
+    auto end = std::chrono::steady_clock::now();
+    PulsarBench bench;
+    bench.threads = main.context->threads();
+        #ifdef PULSAR_STATIC_LATENCY
+    bench.schedule = "static";
+        #endif
+    bench.warmup = PULSAR_BENCH_WARMUP;
+    bench.invocations = PULSAR_BENCH_INVOCATIONS;
+    bench.cycles = main.cycles - start_cycles;
+    bench.seconds = std::chrono::duration<double>(end - start).count();
+    return pulsar_report_bench(bench);
+}
+    #endif
+
+    #ifdef PULSAR_RUNNER
+// the runner links many designs together, each with its own `test`
+static int test(PulsarMain& main);
+    #else
+int test(PulsarMain& main);
+    #endif
+
+// Runs the test, or the benchmark, against a freshly constructed model with
+// its own simulation context.
+static int run_model(int argc, char** argv, PulsarRun& run) {
+    PulsarMain main(run.seed, run.trace_path != nullptr);
+    main.context->commandArgs(argc, argv);
+    #ifdef PULSAR_SAVABLE
+    main.reset_snapshot = std::string(PULSAR_TOP_MODULE) + ".reset."
+                          + std::to_string(getpid()) + ".ckpt";
+    #endif
+    #ifdef PULSAR_TRACE
+    std::unique_ptr<VerilatedFstC> trace;
+    if (run.trace_path) {
+        trace.reset(new VerilatedFstC);
+        main.mod->trace(trace.get(), 99);
+        trace->open(run.trace_path);
+        main.trace = trace.get();
+        main.trace_begin = run.trace_begin;
+        main.trace_end = run.trace_end;
+    }
+    #endif
+    #ifdef PULSAR_BENCH
+    int exit_code = bench(main);
+    #else
+    int exit_code = test(main);
+    #endif
+    run.failed_at = main.failed_at;
+    #ifdef PULSAR_TRACE
+    run.end_cycle = main.context->time() / 2;
+    if (trace) {
+        trace->close();
+    }
+    #endif
+    #ifdef PULSAR_SAVABLE
+    std::remove(main.reset_snapshot.c_str());
+    #endif
+    return exit_code;
+}
+
+// failing runs are only replayed with tracing if the model can write a trace
+static int run_design(int argc, char** argv) {
+    #ifdef PULSAR_TRACE
+    return pulsar_run_design(argc, argv, run_model, true);
+    #else
+    return pulsar_run_design(argc, argv, run_model, false);
+    #endif
+}
+
+    #ifdef PULSAR_RUNNER
+static PulsarRegistration registration(PULSAR_DESIGN, run_design);
+    #else
+int main(int argc, char** argv) {
+    int exit_code = run_design(argc, argv);
+        #ifndef PULSAR_BENCH
+    if (exit_code == 0) {
+        std::cout << "test passed!" << '\n';
+    }
+        #endif
+    exit(exit_code);
+}
+    #endif
+#endif
@@ -1,5 +1,20 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
 #ifdef PULSAR_VERILATOR_TEST
-    #include "VPULSAR_MAIN_MODULE.h"
+    // the adapter includes the header of the design's model and names its
+    // class `PulsarModule`, which is all of the harness that is generated
+    #ifndef PULSAR_ADAPTER
+        #define PULSAR_ADAPTER "adapter.h"
+    #endif
+    #include PULSAR_ADAPTER
     #include "verilated.h"
+    #ifdef PULSAR_TRACE
+        #include "verilated_fst_c.h"
+    #endif
+    #ifdef PULSAR_SAVABLE
+        #include "verilated_save.h"
+        #include <string>
+    #endif
+    #ifdef PULSAR_RUNNER
+        #include "runner.h"
+    #endif
 #endif
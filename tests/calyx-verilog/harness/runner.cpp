@@ -0,0 +1,51 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+#include "runner.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+// see model.cpp
+double sc_time_stamp() {
+    return 0;
+}
+#endif
+
+std::vector<PulsarTestCase>& pulsar_tests() {
+    static std::vector<PulsarTestCase> tests;
+    return tests;
+}
+
+// Runs the designs named on the command line, or every linked design if none
+// are named. Arguments starting with '+' are left to Verilator.
+int main(int argc, char** argv) {
+    std::vector<const char*> names;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '+') {
+            names.push_back(argv[i]);
+        }
+    }
+
+    int failures = 0;
+    size_t found = 0;
+    for (const PulsarTestCase& test : pulsar_tests()) {
+        bool selected = names.empty();
+        for (const char* name : names) {
+            selected = selected || strcmp(name, test.name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        found++;
+        std::cout << "running " << test.name << '\n';
+        int exit_code = test.run(argc, argv);
+        std::cout << test.name << ": "
+                  << (exit_code == 0 ? "test passed!" : "test failed!") << '\n';
+        failures += exit_code != 0;
+    }
+    if (found < names.size()) {
+        std::cout << "error: not every requested design is linked into the "
+                     "runner\n";
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
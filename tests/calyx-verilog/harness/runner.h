@@ -0,0 +1,21 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+#pragma once
+
+#include <vector>
+
+// A design linked into the runner, where `run` constructs its model from the
+// command-line arguments and returns the exit code of its test.
+struct PulsarTestCase {
+    const char* name;
+    int (*run)(int argc, char** argv);
+};
+
+// Every design linked into the runner, in registration order.
+std::vector<PulsarTestCase>& pulsar_tests();
+
+// Adds a design to `pulsar_tests()` during static initialization.
+struct PulsarRegistration {
+    PulsarRegistration(const char* name, int (*run)(int argc, char** argv)) {
+        pulsar_tests().push_back({name, run});
+    }
+};
@@ -0,0 +1,5 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
+// The runner is linked through Verilator against this empty model so the
+// Verilator runtime is compiled exactly once with matching flags.
+module pulsar_runner;
+endmodule
@@ -1,7 +1,33 @@
 // Copyright (C) 2024 Ethan Uppal. All rights reserved.
+#include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
 
-struct PulsarMain {
+// The Makefile passes the reset length the backend reports for the design.
+#ifndef PULSAR_RESET_CYCLES
+    #define PULSAR_RESET_CYCLES 10
+#endif
+
+#ifdef PULSAR_RUNNER
+// every design linked into the runner defines its own `PulsarMain`
+namespace {
+#endif
+
+// An invocation found by `PulsarMain::fuzz` whose result disagreed with the
+// reference, reproducible from `seed` alone.
+struct PulsarFailure {
+    size_t shard;
+    size_t index;
+    int64_t arg;
+    int64_t expected;
+    int64_t received;
+};
+
+struct PulsarMain : PulsarStats {
     struct dummy {
         int64_t ret;
         int64_t arg0;
@@ -17,16 +43,292 @@ struct PulsarMain {
     };
 
 #ifdef HARNESS
-    VPULSAR_MAIN_MODULE* mod;
+    using Module = PulsarModule;
+    // Each instance simulates on its own context, so instances can run on
+    // different threads at once. The model refers to its context, so both
+    // stay where they were allocated while the instance owning them moves.
+    std::unique_ptr<VerilatedContext> context;
+    std::unique_ptr<Module> mod;
+    #ifdef PULSAR_TRACE
+    // Only the time slots in [`trace_begin`, `trace_end`] are written to
+    // `trace`, if there is one.
+    VerilatedFstC* trace = nullptr;
+    uint64_t trace_begin = 0;
+    uint64_t trace_end = 0;
+    void dump();
+    #endif
+    #ifdef PULSAR_SAVABLE
+    // Where `reset()` keeps the post-reset state of the model, and whether
+    // it has been written yet. Later resets restore it instead of clocking
+    // `reset` again.
+    std::string reset_snapshot;
+    bool reset_saved = false;
+
+    // Writes the entire state of the model (but not its context) to `path`.
+    void save(const char* path);
+
+    // Returns the model to the state `save` wrote to `path`.
+    void restore(const char* path);
+    #endif
 #else
-    dummy mod[1];
+    using Module = dummy;
+    std::unique_ptr<dummy> mod{new dummy()};
+#endif
+
+    // The expected result of an invocation on `arg`.
+    using Reference = int64_t (*)(int64_t arg);
+
+    // How many cycles `reset()` holds `reset` high for.
+    size_t reset_cycles = PULSAR_RESET_CYCLES;
+
+#ifdef HARNESS
+    // Builds a fresh model seeded with `seed`, recording activity for a
+    // waveform if `trace` is set. Instances can be moved but never copied,
+    // so that exactly one owns each model, and can be constructed in place
+    // in a container, e.g. `shards.emplace_back(seed)`. They cannot be
+    // assigned, which would destroy the context of the old model before the
+    // model itself.
+    explicit PulsarMain(uint64_t seed = 0, bool trace = false);
+    PulsarMain(PulsarMain&&) = default;
+    PulsarMain(const PulsarMain&) = delete;
+    PulsarMain& operator=(const PulsarMain&) = delete;
+
+    // Finalizes the model before it and then its context are destroyed.
+    ~PulsarMain();
+
+    // A fresh model seeded and reset like this one, e.g. for a shard of a
+    // test running on another thread.
+    PulsarMain fork() const;
 #endif
+
     void cycle();
     void pump();
     void reset();
+
+    // Runs one invocation with the arguments already on the ports, then
+    // lowers `go` and idles for a cycle. When the manifest gives a static
+    // latency, this advances exactly that many cycles instead of waiting for
+    // `done`, checking `done` only with `PULSAR_CHECK_SCHEDULE`.
     void go();
+
+    // Advances the clock until the current invocation is done.
+    void await_done();
+
+    // Runs `count` invocations back-to-back, holding `go` high across them
+    // instead of idling between calls, and returns the total cycle count.
+    // `bind(mod, args[i])` writes the arguments of invocation `i` into the
+    // ports of `mod` and `read(mod)` reads back its result. Both are given by
+    // the caller, so the harness compiles against designs without the ports
+    // they touch, and both are inlined into the loop.
+    template <typename Args, typename Bind, typename Read>
+    uint64_t run_batch(const Args* args, int64_t* rets, size_t count,
+        Bind bind, Read read);
+
+    // Checks `count` random arguments drawn uniformly from [`min`, `max`]
+    // against `reference`, split across `$PULSAR_FUZZ_SHARDS` (or one per
+    // core) independent models on their own threads. The arguments come in
+    // blocks of `PULSAR_FUZZ_BLOCK`, each drawn from a generator seeded by
+    // `seed` and the block's index alone, so they do not depend on how many
+    // shards run them. The cycles and latencies of every shard are added to
+    // this instance.
+    template <typename Bind, typename Read>
+    std::vector<PulsarFailure> fuzz(size_t count, int64_t min, int64_t max,
+        Reference reference, Bind bind, Read read);
+
+    // Copies `length` elements of `data` into the memory `name` on the
+    // top-level component, e.g. `_arg0` for an array parameter of `main`,
+    // without advancing the clock.
+    void write_memory(const char* name, const int64_t* data, size_t length);
+
+    // Copies the `length` elements of the memory `name` on the top-level
+    // component into `data`, e.g. `_ret` for an array `main` returns.
+    void read_memory(const char* name, int64_t* data, size_t length);
+};
+
+// Writes argument `I` of an invocation to the port `arg<I>`, which is only
+// looked up in designs that bind it.
+template <size_t I>
+struct PulsarPort;
+
+#define PULSAR_PORT(i)                                                   \
+    template <>                                                          \
+    struct PulsarPort<i> {                                               \
+        template <typename Module>                                       \
+        static void bind(Module* mod, int64_t value) {                   \
+            mod->arg##i = value;                                         \
+        }                                                                \
+    };
+PULSAR_PORT(0)
+PULSAR_PORT(1)
+PULSAR_PORT(2)
+PULSAR_PORT(3)
+PULSAR_PORT(4)
+PULSAR_PORT(5)
+PULSAR_PORT(6)
+PULSAR_PORT(7)
+PULSAR_PORT(8)
+PULSAR_PORT(9)
+#undef PULSAR_PORT
+
+template <size_t>
+using PulsarInt = int64_t;
+
+// Invokes a design whose scalar arguments are the ports `arg<Ports>...`, in
+// order, mapping a tuple of arguments onto them at compile time.
+template <size_t... Ports>
+struct PulsarInvoker {
+    using Arguments = std::tuple<PulsarInt<Ports>...>;
+
+    template <typename Module>
+    static void bind(Module* mod, const Arguments& args) {
+        bind(mod, args, std::make_index_sequence<sizeof...(Ports)>());
+    }
+
+    template <typename Module>
+    static int64_t read(Module* mod) {
+        return mod->ret;
+    }
+
+    static int64_t invoke(PulsarMain& plsr, const Arguments& args) {
+        bind(plsr.mod.get(), args);
+        plsr.go();
+        return read(plsr.mod.get());
+    }
+
+    // Runs every tuple in `args` back-to-back, see `PulsarMain::run_batch`.
+    static uint64_t run_batch(PulsarMain& plsr,
+        const std::vector<Arguments>& args, std::vector<int64_t>& rets) {
+        rets.resize(args.size());
+        return plsr.run_batch(args.data(), rets.data(), args.size(),
+            [](PulsarMain::Module* mod, const Arguments& args) {
+                bind(mod, args);
+            },
+            [](PulsarMain::Module* mod) { return read(mod); });
+    }
+
+private:
+    template <typename Module, size_t... I>
+    static void bind(Module* mod, const Arguments& args,
+        std::index_sequence<I...>) {
+        int expand[] = {
+            0, (PulsarPort<Ports>::bind(mod, std::get<I>(args)), 0)...};
+        (void)expand;
+    }
 };
 
+// The build passes the scalar ports of the design as reported by the backend.
+#ifdef PULSAR_PORTS
+using PulsarMainInvoker = PulsarInvoker<PULSAR_PORTS>;
+#endif
+
+// A first-in first-out queue of at most `capacity` elements, which never
+// allocates once constructed.
+template <typename T>
+class PulsarRing {
+public:
+    explicit PulsarRing(size_t capacity) : slots(capacity) {}
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    bool full() const {
+        return count == slots.size();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    const T& front() const {
+        return slots[head];
+    }
+
+    void push(const T& value) {
+        slots[(head + count) % slots.size()] = value;
+        count++;
+    }
+
+    void pop() {
+        head = (head + 1) % slots.size();
+        count--;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+// The valid/ready ports of a streaming design, which takes elements on
+// `in_data` and gives them on `out_data`. An element moves on a rising edge
+// where its side's valid and ready are both high. A design with other names
+// for these ports is streamed with its own struct of the same functions.
+struct PulsarStreamPorts {
+    template <typename Module>
+    static void offer(Module* mod, bool valid, int64_t data) {
+        mod->in_valid = valid;
+        mod->in_data = data;
+    }
+
+    template <typename Module>
+    static bool ready(Module* mod) {
+        return mod->in_ready;
+    }
+
+    template <typename Module>
+    static void accept(Module* mod, bool ready) {
+        mod->out_ready = ready;
+    }
+
+    template <typename Module>
+    static bool valid(Module* mod) {
+        return mod->out_valid;
+    }
+
+    template <typename Module>
+    static int64_t data(Module* mod) {
+        return mod->out_data;
+    }
+};
+
+// Feeds a streaming design from a ring buffer and drains it into another,
+// moving at most one element in and one out on each cycle of `plsr`.
+template <typename Ports = PulsarStreamPorts>
+struct PulsarStream {
+    PulsarMain& plsr;
+    PulsarRing<int64_t> input;
+    PulsarRing<int64_t> output;
+
+    // The elements that have entered and left the design, and the cycles
+    // this has run it for.
+    uint64_t consumed = 0;
+    uint64_t produced = 0;
+    uint64_t cycles = 0;
+
+    PulsarStream(PulsarMain& plsr, size_t capacity)
+        : plsr(plsr), input(capacity), output(capacity) {}
+
+    // Offers the front of `input` if there is one and accepts an element if
+    // `output` has room, then runs a cycle and moves whatever the design
+    // handshook on its edge between the rings.
+    void step();
+
+    // Streams the `count` elements of `in` through the design into `out`,
+    // topping up and draining the rings on every cycle, and returns how many
+    // cycles it took. Exits if no element moves for `PULSAR_STREAM_STALL`
+    // cycles in a row.
+    uint64_t run(const int64_t* in, int64_t* out, size_t count);
+
+    // Writes the elements moved and the cycles taken to `out` as a single
+    // JSON object.
+    void dump_stats(std::ostream& out) const;
+};
+
+#ifdef PULSAR_RUNNER
+}
+#endif
+
 #ifndef plsr_reset
     #define plsr_reset(plsr) (plsr).reset()
 #endif
@@ -42,3 +344,54 @@ struct PulsarMain {
 #ifndef plsr_ret
     #define plsr_ret(plsr) (plsr).mod->ret
 #endif
+
+#ifndef plsr_stats
+    #define plsr_stats(plsr) (plsr).dump_stats(std::cout)
+#endif
+
+#ifndef plsr_save
+    #define plsr_save(plsr, path) (plsr).save(path)
+#endif
+
+#ifndef plsr_restore
+    #define plsr_restore(plsr, path) (plsr).restore(path)
+#endif
+
+#ifndef plsr_fail
+    #define plsr_fail(plsr, invocation) (plsr).fail(invocation)
+#endif
+
+#ifndef plsr_check
+    #define plsr_check(plsr, args, expected, rets)                       \
+        (plsr).check(                                                    \
+            (args).data(), (expected).data(), (rets).data(), (rets).size())
+#endif
+
+#ifndef plsr_fuzz
+    #define plsr_fuzz(plsr, count, min, max, reference)                  \
+        (plsr).fuzz(count, min, max, reference,                          \
+            [](PulsarMain::Module* mod, int64_t arg) { mod->arg0 = arg; }, \
+            [](PulsarMain::Module* mod) -> int64_t { return mod->ret; })
+#endif
+
+#ifndef plsr_load
+    #define plsr_load(plsr, i, buffer)                                   \
+        (plsr).write_memory("_arg" #i, (buffer).data(), (buffer).size())
+#endif
+
+#ifndef plsr_read_ret
+    #define plsr_read_ret(plsr, buffer)                                  \
+        (plsr).read_memory("_ret", (buffer).data(), (buffer).size())
+#endif
+
+#ifndef plsr_invoke
+    #define plsr_invoke(plsr, ...)                                       \
+        PulsarMainInvoker::invoke(plsr, std::make_tuple(__VA_ARGS__))
+#endif
+
+#ifndef plsr_run_batch
+    #define plsr_run_batch(plsr, args, rets)                              \
+        (plsr).run_batch((args).data(), (rets).data(), (args).size(),    \
+            [](PulsarMain::Module* mod, int64_t arg) { mod->arg0 = arg; }, \
+            [](PulsarMain::Module* mod) -> int64_t { return mod->ret; })
+#endif
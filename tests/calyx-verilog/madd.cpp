@@ -0,0 +1,49 @@
+#include "harness/test.h"
+#include "harness/reference.h"
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+int test(PulsarMain& plsr) {
+    std::cout << "seed: " << plsr.seed << '\n';
+    std::mt19937_64 generator(plsr.seed);
+    std::uniform_int_distribution<int64_t> distribution(-1000, 1000);
+    std::vector<PulsarMainInvoker::Arguments> args(1000);
+    for (PulsarMainInvoker::Arguments& arg : args) {
+        arg = std::make_tuple(distribution(generator), distribution(generator),
+            distribution(generator));
+    }
+    plsr_reset(plsr);
+    int64_t result = plsr_invoke(plsr, 6, 7, -2);
+    if (result != 40) {
+        std::cout << "test failed: expected: 40 but received: " << result
+                  << '\n';
+        plsr_fail(plsr, 0);
+        return 1;
+    }
+    std::vector<int64_t> rets;
+    uint64_t cycles = PulsarMainInvoker::run_batch(plsr, args, rets);
+    std::cout << "cycles: " << cycles << '\n';
+    for (size_t i = 0; i < args.size(); i++) {
+        int64_t expected = std::get<0>(args[i]) * std::get<1>(args[i])
+                           + std::get<2>(args[i]);
+        if (rets[i] != expected) {
+            std::cout << "test failed: expected: " << expected
+                      << " but received: " << rets[i] << '\n';
+            plsr_fail(plsr, i + 1);
+            return 1;
+        }
+        // the reference shares the design's IR, so it is held to the
+        // answers too
+        int64_t reference = pulsar_reference::top(std::get<0>(args[i]),
+            std::get<1>(args[i]), std::get<2>(args[i]));
+        if (reference != expected) {
+            std::cout << "test failed: expected: " << expected
+                      << " but the reference computed: " << reference << '\n';
+            return 1;
+        }
+    }
+    plsr_stats(plsr);
+    return 0;
+}
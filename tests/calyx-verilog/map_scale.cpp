@@ -0,0 +1,49 @@
+#include "harness/test.h"
+#include "harness/random.h"
+#include "harness/reference.h"
+#include <iostream>
+#include <vector>
+
+// `make map-scale` builds this against copies of squares.plsr with other
+// parallel factors and lengths, so the buffers are sized from the manifest
+
+int test(PulsarMain& plsr) {
+    std::cout << "seed: " << plsr.seed << '\n';
+    PulsarRandom generator(plsr.seed);
+    std::vector<int64_t> xs(PULSAR_MEMORY_LENGTH_arg0);
+    std::vector<int64_t> expected(xs.size());
+    std::vector<int64_t> reference(xs.size());
+    std::vector<int64_t> ys(PULSAR_MEMORY_LENGTH_ret);
+    plsr_reset(plsr);
+    for (int i = 0; i < 10; i++) {
+        generator.fill_golden(xs.data(), expected.data(), xs.size(), -1000,
+            1000, [](int64_t x) { return x * x; });
+        // the reference shares the design's IR, so it is held to the
+        // answers too
+        pulsar_reference::top(xs.data(), reference.data());
+        std::vector<size_t> wrong = pulsar_mismatches(
+            expected.data(), reference.data(), reference.size(), 1);
+        if (!wrong.empty()) {
+            size_t j = wrong[0];
+            std::cout << "test failed: expected: " << expected[j]
+                      << " but the reference computed: " << reference[j]
+                      << " at index " << j << '\n';
+            return 1;
+        }
+        plsr_load(plsr, 0, xs);
+        plsr_go(plsr);
+        plsr_read_ret(plsr, ys);
+        std::vector<size_t> mismatches =
+            pulsar_mismatches(expected.data(), ys.data(), ys.size(), 1);
+        if (!mismatches.empty()) {
+            size_t j = mismatches[0];
+            std::cout << "test failed: expected: " << expected[j]
+                      << " but received: " << ys[j] << " at index " << j
+                      << '\n';
+            plsr_fail(plsr, i);
+            return 1;
+        }
+    }
+    plsr_stats(plsr);
+    return 0;
+}
@@ -1,20 +1,29 @@
 #include "harness/test.h"
+#include "harness/reference.h"
 #include <iostream>
 #include <cstddef>
 #include <cstdlib>
 
-int test(PulsarMain plsr) {
+int test(PulsarMain& plsr) {
     plsr_reset(plsr);
     plsr_go(plsr);
     // the program maps (+ 1) over a singleton array of 1 and returns the first
     // element in the array
-    int result = plsr_ret(plsr);
+    int64_t result = plsr_ret(plsr);
     std::cout << "result: " << result << '\n';
-    const int exp = 2;
+    const int64_t exp = 2;
     if (result != exp) {
         std::cout << "test failed: expected: " << exp
                   << " but received: " << result << '\n';
         return 1;
     }
+    // the reference shares the design's IR, so it is held to the answer too
+    const int64_t reference = pulsar_reference::top(0);
+    if (reference != exp) {
+        std::cout << "test failed: expected: " << exp
+                  << " but the reference computed: " << reference << '\n';
+        return 1;
+    }
+    plsr_stats(plsr);
     return 0;
 }
@@ -0,0 +1 @@
+// Copyright (C) 2024 Ethan Uppal. All rights reserved.
@@ -1,27 +1,59 @@
 #include "harness/test.h"
+#include "harness/random.h"
+#include "harness/reference.h"
 #include <iostream>
 #include <cstddef>
-#include <ctime>
 #include <cstdlib>
-#include <random>
+#include <vector>
 
-int test(PulsarMain plsr) {
-    std::mt19937 generator(time(NULL));
-    std::uniform_int_distribution<> distribution(0, 999);
+int test(PulsarMain& plsr) {
+    std::vector<int64_t> args(1000);
+    std::vector<int64_t> expected(args.size());
+    std::vector<int64_t> rets(args.size());
+    PulsarRandom(plsr.seed).fill_golden(args.data(), expected.data(),
+        args.size(), 0, 999, [](int64_t arg) { return arg * arg; });
     plsr_reset(plsr);
-    for (int i = 0; i < 1000; i++) {
-        unsigned int arg = distribution(generator);
-        if (arg < 0) {
-            arg = -arg;
+    uint64_t cycles = plsr_run_batch(plsr, args, rets);
+    std::cout << "cycles: " << cycles << '\n';
+    if (plsr_check(plsr, args, expected, rets) != 0) {
+        return 1;
+    }
+    // the reference shares the design's IR, so it is held to the answers too
+    for (size_t i = 0; i < args.size(); i++) {
+        int64_t reference = pulsar_reference::top(args[i]);
+        if (reference != expected[i]) {
+            std::cout << "test failed: expected: " << expected[i]
+                      << " but the reference computed: " << reference
+                      << " on input " << args[i] << '\n';
+            return 1;
         }
-        plsr_arg(plsr, 0, arg);
+    }
+    // single invocations, which a statically scheduled design clocks for the
+    // latency in its manifest, must leave it idle with `go` low
+    for (size_t i = 0; i < 10; i++) {
+        plsr_arg(plsr, 0, args[i]);
         plsr_go(plsr);
-        int result = plsr_ret(plsr);
-        if (result != arg * arg) {
-            std::cout << "test failed: expected: " << (arg * arg)
-                      << " but received: " << result << '\n';
+        int64_t result = plsr_ret(plsr);
+        if (result != expected[i]) {
+            std::cout << "test failed: expected: " << expected[i]
+                      << " but received: " << result << " on input "
+                      << args[i] << " invoked alone" << '\n';
+            return 1;
+        }
+        if (plsr.mod->go || plsr.mod->done) {
+            std::cout << "test failed: invocation " << i << " left "
+                      << (plsr.mod->go ? "go" : "done") << " high" << '\n';
+            return 1;
+        }
+    #ifdef PULSAR_STATIC_LATENCY
+        if (plsr.latencies.back() != PULSAR_STATIC_LATENCY) {
+            std::cout << "test failed: invocation " << i << " took "
+                      << plsr.latencies.back() << " cycles, not the "
+                      << PULSAR_STATIC_LATENCY << " in the manifest" << '\n';
             return 1;
         }
+    #endif
     }
+    plsr_stats(plsr);
     return 0;
 }
@@ -0,0 +1,106 @@
+#include "harness/test.h"
+#include "harness/random.h"
+#include <iostream>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+// stream.sv computes 3x + 1 with a two-stage pipeline
+static int64_t expected(int64_t x) {
+    return 3 * x + 1;
+}
+
+// Pushes and pops a small ring at random so that it wraps around many times,
+// checking it against a deque after every operation.
+static bool check_ring(uint64_t seed) {
+    const size_t capacity = 3;
+    PulsarRing<int64_t> ring(capacity);
+    std::deque<int64_t> queue;
+    PulsarRandom random(seed);
+    for (int64_t i = 0; i < 1000; i++) {
+        bool push = random.next() % 2 == 0;
+        if (push && !ring.full()) {
+            ring.push(i);
+            queue.push_back(i);
+        } else if (!push && !ring.empty()) {
+            ring.pop();
+            queue.pop_front();
+        }
+        if (ring.size() != queue.size() || ring.empty() != queue.empty()
+            || ring.full() != (queue.size() == capacity)
+            || (!queue.empty() && ring.front() != queue.front())) {
+            std::cout << "test failed: ring disagrees with a deque after "
+                      << i + 1 << " operations" << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+// Steps the design without draining its output ring, which must stop it once
+// the ring is full and hold every element already inside it until the ring
+// is drained.
+static bool check_backpressure(PulsarMain& plsr) {
+    plsr_reset(plsr);
+    PulsarStream<> stream(plsr, 2);
+    int64_t next = 1;
+    for (int i = 0; i < 10; i++) {
+        while (!stream.input.full() && next <= 4) {
+            stream.input.push(next++);
+        }
+        stream.step();
+    }
+    // two elements fill the output ring and the other two the pipeline
+    if (!stream.output.full() || stream.produced != 2
+        || stream.consumed != 4) {
+        std::cout << "test failed: a full output ring let " << stream.produced
+                  << " elements out and " << stream.consumed << " in" << '\n';
+        return false;
+    }
+    for (int64_t x = 1; x <= 4; x++) {
+        if (stream.output.empty()) {
+            stream.step();
+        }
+        if (stream.output.empty() || stream.output.front() != expected(x)) {
+            std::cout << "test failed: element " << x
+                      << " was lost or reordered under backpressure" << '\n';
+            return false;
+        }
+        stream.output.pop();
+    }
+    return true;
+}
+
+int test(PulsarMain& plsr) {
+    if (!check_ring(plsr.seed) || !check_backpressure(plsr)) {
+        return 1;
+    }
+
+    std::vector<int64_t> in(10000);
+    std::vector<int64_t> out(in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = int64_t(i) * 7 - 5000;
+    }
+    plsr_reset(plsr);
+    PulsarStream<> stream(plsr, 16);
+    uint64_t cycles = stream.run(in.data(), out.data(), in.size());
+    std::cout << "cycles: " << cycles << '\n';
+    for (size_t i = 0; i < in.size(); i++) {
+        if (out[i] != expected(in[i])) {
+            std::cout << "test failed: expected: " << expected(in[i])
+                      << " but received: " << out[i] << " on input " << in[i]
+                      << '\n';
+            return 1;
+        }
+    }
+    // the pipeline is never stalled, so it moves an element every cycle
+    // once it has filled
+    if (cycles > in.size() + 2) {
+        std::cout << "test failed: took " << cycles << " cycles to stream "
+                  << in.size() << " elements" << '\n';
+        return 1;
+    }
+    stream.dump_stats(std::cout);
+    return 0;
+}
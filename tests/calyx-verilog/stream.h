@@ -0,0 +1,14 @@
+// Written by hand for stream.sv, in the form the compiler writes next to a
+// design's manifest.
+#ifndef PULSAR_TOP_MODULE
+    #define PULSAR_TOP_MODULE "stream"
+#endif
+#ifndef PULSAR_RESET_CYCLES
+    #define PULSAR_RESET_CYCLES 10
+#endif
+#ifndef PULSAR_PORTS
+    #define PULSAR_PORTS
+#endif
+#ifndef PULSAR_MEMORIES
+    #define PULSAR_MEMORIES 0
+#endif
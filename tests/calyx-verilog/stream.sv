@@ -0,0 +1,42 @@
+// A hand-written streaming design, since the compiler does not emit any yet,
+// for testing how the harness streams elements through a design. It is a
+// two-stage pipeline computing 3x + 1 that holds both stages, and stops
+// taking elements, for as long as the element on `out_data` is not accepted.
+// `go` and `done` are unused and only present for the parts of the harness
+// that invoke a design.
+module stream(
+  input logic clk,
+  input logic reset,
+  input logic go,
+  output logic done,
+  input logic in_valid,
+  input logic [63:0] in_data,
+  output logic in_ready,
+  output logic out_valid,
+  output logic [63:0] out_data,
+  input logic out_ready
+);
+  logic first_valid;
+  logic [63:0] first_data;
+  logic second_valid;
+  logic [63:0] second_data;
+  logic stall;
+
+  assign done = go;
+  assign stall = second_valid && !out_ready;
+  assign in_ready = !stall;
+  assign out_valid = second_valid;
+  assign out_data = second_data;
+
+  always_ff @(posedge clk) begin
+    if (reset) begin
+      first_valid <= 1'b0;
+      second_valid <= 1'b0;
+    end else if (!stall) begin
+      first_valid <= in_valid;
+      first_data <= in_data * 64'd3;
+      second_valid <= first_valid;
+      second_data <= first_data + 64'd1;
+    end
+  end
+endmodule
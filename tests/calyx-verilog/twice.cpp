@@ -1,23 +1,34 @@
 #include "harness/test.h"
+#include "harness/reference.h"
 #include <iostream>
-#include <ctime>
-#include <random>
 
-int test(PulsarMain plsr) {
-    plsr_reset(plsr);
-    std::mt19937 generator(time(NULL));
-    std::uniform_int_distribution<> distribution(0, 999);
-    for (int i = 0; i < 1000; i++) {
-        unsigned int arg = distribution(generator);
-        plsr_arg(plsr, 0, arg);
-        plsr_go(plsr);
-        int result = plsr_ret(plsr);
-        std::cout << "result: " << result << '\n';
-        if (result != arg * 2) {
-            std::cout << "test failed: expected: " << (arg * 2)
-                      << " but received: " << result << '\n';
+int test(PulsarMain& plsr) {
+    std::cout << "seed: " << plsr.seed << '\n';
+    std::vector<PulsarFailure> failures = plsr_fuzz(plsr, 100000, 0, 999,
+        [](int64_t x) -> int64_t { return x * 2; });
+    for (size_t i = 0; i < failures.size() && i < 10; i++) {
+        const PulsarFailure& failure = failures[i];
+        std::cout << "test failed: expected: " << failure.expected
+                  << " but received: " << failure.received << " on input "
+                  << failure.arg << " (shard " << failure.shard << ", vector "
+                  << failure.index << ")" << '\n';
+    }
+    if (!failures.empty()) {
+        std::cout << failures.size() << " failures, rerun with +seed="
+                  << plsr.seed << " to reproduce" << '\n';
+        return 1;
+    }
+    // the reference shares the design's IR, so it is held to the answers
+    // too, on every input the fuzzer draws from
+    for (int64_t x = 0; x <= 999; x++) {
+        int64_t reference = pulsar_reference::top(x);
+        if (reference != x * 2) {
+            std::cout << "test failed: expected: " << x * 2
+                      << " but the reference computed: " << reference
+                      << " on input " << x << '\n';
             return 1;
         }
     }
+    plsr_stats(plsr);
     return 0;
 }
@@ -0,0 +1,19 @@
+#[cfg(test)]
+mod tests {
+    use pulsar_backend::calyx::CalyxPasses;
+
+    #[test]
+    fn test_pass_sets_parse() {
+        assert_eq!("fast".parse::<CalyxPasses>(), Ok(CalyxPasses::Fast));
+        assert_eq!("full".parse::<CalyxPasses>(), Ok(CalyxPasses::Full));
+        assert_eq!(CalyxPasses::default(), CalyxPasses::Full);
+    }
+
+    #[test]
+    fn test_unknown_pass_set_is_rejected() {
+        for name in ["", "Fast", "all", "fast,full"] {
+            let error = name.parse::<CalyxPasses>().unwrap_err();
+            assert!(error.contains(&format!("'{}'", name)), "{}", error);
+        }
+    }
+}
@@ -1,29 +1,42 @@
 #[cfg(test)]
 mod tests {
-    use std::{
-        env,
-        fmt::Display,
-        process::{exit, Command}
-    };
+    use std::{fmt::Display, path::PathBuf, process::Command};
 
     const CALYX_VERILOG_TEST_DIR: &str = "tests/calyx-verilog";
+    const RUNNER: &str = "build/runner/link/pulsar_runner";
 
+    fn test_dir() -> PathBuf {
+        PathBuf::from(env!("CARGO_MANIFEST_DIR")).join(CALYX_VERILOG_TEST_DIR)
+    }
+
+    /// Runs the test for the design `name` in the runner executable that all
+    /// designs are linked into. The runner is built once (the `make runner`
+    /// target serializes concurrent builds and is a no-op when up to date),
+    /// and nothing here changes process-wide state, so tests may run in
+    /// parallel.
     fn run_verilator_test<S: Display>(name: S) {
-        let cwd = env::current_dir()
-            .expect("Failed to get the current working directory");
-        env::set_current_dir(CALYX_VERILOG_TEST_DIR)
-            .expect("Failed to change directory");
-        let output = Command::new("make")
-            .arg(format!("N={}", name))
+        let build = Command::new("make")
+            .arg("runner")
+            .current_dir(test_dir())
             .output()
             .expect("Failed to execute command");
+        assert!(
+            build.status.success(),
+            "Failed to build the runner:\n{}{}",
+            String::from_utf8_lossy(&build.stdout),
+            String::from_utf8_lossy(&build.stderr)
+        );
 
-        let status = output.status.code().unwrap_or(1);
-        if status != 0 {
-            exit(status);
-        }
-        env::set_current_dir(cwd.as_path())
-            .expect("Failed to restore the current working directory");
+        let output = Command::new(test_dir().join(RUNNER))
+            .arg(name.to_string())
+            .current_dir(test_dir())
+            .output()
+            .expect("Failed to execute command");
+        assert!(
+            output.status.success(),
+            "{}",
+            String::from_utf8_lossy(&output.stdout)
+        );
     }
 
     #[test]
@@ -50,4 +63,19 @@ mod tests {
     fn math() {
         run_verilator_test("math");
     }
+
+    #[test]
+    fn squares() {
+        run_verilator_test("squares");
+    }
+
+    #[test]
+    fn madd() {
+        run_verilator_test("madd");
+    }
+
+    #[test]
+    fn stream() {
+        run_verilator_test("stream");
+    }
 }
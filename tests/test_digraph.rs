@@ -2,6 +2,23 @@
 mod tests {
     use proptest::prelude::*;
     use pulsar_utils::digraph::Digraph;
+    use std::collections::{HashMap, HashSet};
+
+    fn reaches(graph: &Digraph<u8, ()>, from: u8, to: u8) -> bool {
+        let mut visited = HashSet::new();
+        let mut stack = vec![from];
+        while let Some(node) = stack.pop() {
+            if node == to {
+                return true;
+            }
+            if visited.insert(node) {
+                for (_, next) in graph.out_of(node).unwrap() {
+                    stack.push(*next);
+                }
+            }
+        }
+        false
+    }
 
     proptest! {
         #[test]
@@ -28,5 +45,33 @@ mod tests {
                 prop_assert!(out.contains(&(e, v)));
             }
         }
+
+        #[test]
+        fn test_strongly_connected_components(edges: Vec<(u8, u8)>) {
+            let mut graph = Digraph::new();
+            for (u, v) in edges.clone() {
+                graph.add_node(u);
+                graph.add_node(v);
+            }
+            for (u, v) in edges.clone() {
+                graph.add_edge(u, (), v);
+            }
+            let components = graph.strongly_connected_components();
+            let mut component_of = HashMap::new();
+            for (i, component) in components.iter().enumerate() {
+                for node in component {
+                    prop_assert!(component_of.insert(*node, i).is_none());
+                    prop_assert!(reaches(&graph, *node, component[0]));
+                    prop_assert!(reaches(&graph, component[0], *node));
+                }
+            }
+            prop_assert_eq!(graph.node_count(), component_of.len());
+            for (u, v) in edges {
+                prop_assert!(component_of[&v] <= component_of[&u]);
+                if component_of[&v] < component_of[&u] {
+                    prop_assert!(!reaches(&graph, v, u));
+                }
+            }
+        }
     }
 }
@@ -0,0 +1,151 @@
+//! Measures how much memory the frontend needs for a large generated program.
+//! This file is its own test binary, so the counting allocator below sees
+//! only the one test in it.
+use pulsar_utils::stats::CountingAllocator;
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+#[cfg(test)]
+mod tests {
+    use pulsar_frontend::{
+        ast::{Expr, ExprValue, Node, NodeValue},
+        lexer::Lexer,
+        parser::Parser,
+        static_analysis::StaticAnalyzer
+    };
+    use pulsar_utils::{error::ErrorManager, loc::Source, stats::Phases};
+    use std::fmt::Write;
+
+    const FUNCTIONS: usize = 2000;
+
+    /// Bytes of heap in use at the peak of each stage, per byte of source.
+    const MAX_LEX_PEAK_PER_BYTE: usize = 32;
+    const MAX_PARSE_PEAK_PER_BYTE: usize = 64;
+    const MAX_INFER_PEAK_PER_BYTE: usize = 48;
+
+    /// Allocations made by each stage, per node of the tree it produces or
+    /// checks. Tokens carry interned text, so lexing allocates only once per
+    /// distinct name, and copying a token into the tree allocates nothing.
+    const MAX_LEX_ALLOCATIONS_PER_NODE: f64 = 0.1;
+    const MAX_PARSE_ALLOCATIONS_PER_NODE: f64 = 6.0;
+    const MAX_INFER_ALLOCATIONS_PER_NODE: f64 = 2.0;
+
+    /// A program of `functions` functions that each call the one before.
+    fn generate(functions: usize) -> String {
+        let mut program = String::new();
+        writeln!(program, "func f0(x: Int) -> Int {{\n    return x\n}}\n")
+            .unwrap();
+        for i in 1..functions {
+            writeln!(
+                program,
+                "\
+func f{i}(value: Int) -> Int {{
+    let scaled = f{j}(value) * 3 + value
+    let values = [scaled, value, 2, 4]
+    let doubled = map<2>(f{j}, values)
+    return scaled - value * scaled
+}}
+",
+                i = i,
+                j = i - 1
+            )
+            .unwrap();
+        }
+        writeln!(
+            program,
+            "func main(a: Int) -> Int {{\n    return f{}(a)\n}}",
+            functions - 1
+        )
+        .unwrap();
+        program
+    }
+
+    /// The number of statements and expressions in `expr`.
+    fn count_expr(expr: &Expr) -> usize {
+        1 + match &expr.value {
+            ExprValue::ConstantInt(_) | ExprValue::BoundName(_) => 0,
+            ExprValue::MemberAccess(value, _)
+            | ExprValue::PrefixOp(_, value)
+            | ExprValue::HardwareMap(_, _, _, value) => count_expr(value),
+            ExprValue::Call(_, values) | ExprValue::ArrayLiteral(values, _) => {
+                values.iter().map(count_expr).sum()
+            }
+            ExprValue::InfixBop(lhs, _, rhs)
+            | ExprValue::PostfixBop(lhs, _, rhs, _) => {
+                count_expr(lhs) + count_expr(rhs)
+            }
+        }
+    }
+
+    /// The number of statements and expressions in `nodes`.
+    fn count_nodes(nodes: &[Node]) -> usize {
+        nodes
+            .iter()
+            .map(|node| {
+                1 + match &node.value {
+                    NodeValue::Function { body, .. } => count_nodes(body),
+                    NodeValue::LetBinding { value, .. } => count_expr(value),
+                    NodeValue::Return { value, .. } => {
+                        value.as_deref().map_or(0, count_expr)
+                    }
+                }
+            })
+            .sum()
+    }
+
+    #[test]
+    fn test_frontend_peak_memory() {
+        let contents = generate(FUNCTIONS);
+        let length = contents.len();
+        let error_manager = ErrorManager::with_max_count(10);
+        let source = Source::file("large.plsr".into(), contents);
+
+        let mut phases = Phases::recording();
+        let tokens = phases.measure("lex", || {
+            Lexer::new(source, error_manager.clone())
+                .into_iter()
+                .collect::<Vec<_>>()
+        });
+        let program_ast = phases.measure("parse", || {
+            Parser::new(tokens, error_manager.clone())
+                .into_iter()
+                .collect::<Vec<_>>()
+        });
+        assert!(!error_manager.borrow().has_errors());
+        let nodes = count_nodes(&program_ast);
+        let annotated_ast = phases.measure("infer", || {
+            StaticAnalyzer::new(error_manager.clone()).infer(program_ast)
+        });
+        assert!(annotated_ast.is_some());
+
+        print!(
+            "{} bytes of source in {} nodes\n{}",
+            length,
+            nodes,
+            phases.to_text("large.plsr")
+        );
+        let limits = [
+            (MAX_LEX_PEAK_PER_BYTE, MAX_LEX_ALLOCATIONS_PER_NODE),
+            (MAX_PARSE_PEAK_PER_BYTE, MAX_PARSE_ALLOCATIONS_PER_NODE),
+            (MAX_INFER_PEAK_PER_BYTE, MAX_INFER_ALLOCATIONS_PER_NODE)
+        ];
+        for (phase, (peak_per_byte, allocations_per_node)) in
+            phases.iter().zip(limits)
+        {
+            assert!(
+                phase.peak_heap <= peak_per_byte * length,
+                "{} peaked at {} bytes of heap",
+                phase.name,
+                phase.peak_heap
+            );
+            let per_node = phase.allocations as f64 / nodes as f64;
+            assert!(
+                per_node <= allocations_per_node,
+                "{} made {:.2} allocations per node",
+                phase.name,
+                per_node
+            );
+        }
+    }
+}
@@ -13,4 +13,21 @@ mod tests {
             }
         }
     }
+
+    #[test]
+    fn test_reset_restarts_numbering() {
+        Gen::reset();
+        let first = Gen::next("reset");
+        Gen::next("reset");
+        Gen::reset();
+        assert_eq!(first, Gen::next("reset"));
+    }
+
+    #[test]
+    fn test_threads_number_independently() {
+        Gen::reset();
+        let here = Gen::next("thread");
+        let there = std::thread::spawn(|| Gen::next("thread")).join().unwrap();
+        assert_eq!(here, there);
+    }
 }
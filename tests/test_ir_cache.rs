@@ -0,0 +1,215 @@
+#[cfg(test)]
+mod tests {
+    use pulsar_frontend::{
+        ast::Node, lexer::Lexer, parser::Parser,
+        static_analysis::StaticAnalyzer
+    };
+    use pulsar_ir::{
+        cache::IrCache, generator::Generator, lower::lower_program
+    };
+    use pulsar_utils::{
+        error::ErrorManager, id::Gen, loc::Source, stats::Phases
+    };
+    use std::{
+        collections::HashMap, env, fmt::Write, fs, path::PathBuf, process
+    };
+
+    const PROGRAM: &str = "\
+func square(x: Int) -> Int {
+    return x * x
+}
+
+pure func twice(x: Int) -> Int {
+    return x + x
+}
+
+func main(a: Int) -> Int[4] {
+    let b = twice(square(a))
+    let c = [b, 2, 3, 4]
+    return map<2>(twice, c)
+}
+";
+
+    fn parse(contents: &str) -> Vec<Node> {
+        let error_manager = ErrorManager::with_max_count(10);
+        let source = Source::file("test.plsr".into(), contents.into());
+        let lexer = Lexer::new(source, error_manager.clone());
+        let tokens: Vec<_> = lexer.into_iter().collect();
+        let parser = Parser::new(tokens, error_manager.clone());
+        let program_ast: Vec<_> = parser.into_iter().collect();
+        assert!(!error_manager.borrow().has_errors());
+        program_ast
+    }
+
+    fn cache_keys(cache: &IrCache, contents: &str) -> Vec<u64> {
+        let program_ast = parse(contents);
+        let signatures: HashMap<_, _> =
+            program_ast.iter().filter_map(Node::signature).collect();
+        program_ast
+            .iter()
+            .map(|node| cache.key(node, &signatures))
+            .collect()
+    }
+
+    fn keys(contents: &str) -> Vec<u64> {
+        // only for its keys, so nothing is written
+        let cache = IrCache::new(env::temp_dir()).unwrap();
+        cache_keys(&cache, contents)
+    }
+
+    fn cache_dir(name: &str) -> PathBuf {
+        let dir = env::temp_dir().join(format!(
+            "pulsar-ir-cache-{}-{}",
+            name,
+            process::id()
+        ));
+        let _ = fs::remove_dir_all(&dir);
+        dir
+    }
+
+    #[test]
+    fn test_round_trip() {
+        let dir = cache_dir("round-trip");
+        let cache = IrCache::new(dir.clone()).unwrap();
+        let program_ast = parse(PROGRAM);
+        let keys = cache_keys(&cache, PROGRAM);
+        let error_manager = ErrorManager::with_max_count(10);
+        let annotated_ast = StaticAnalyzer::new(error_manager)
+            .infer(program_ast)
+            .unwrap();
+        for (generated, key) in Generator::new(annotated_ast).zip(&keys) {
+            assert!(cache.load(*key).is_none());
+            cache.store(*key, &generated).unwrap();
+            let loaded = cache.load(*key).unwrap();
+            // loaded IR has fresh variables, but is stored the same way
+            cache.store(!*key, &loaded).unwrap();
+            assert_eq!(
+                fs::read(dir.join(format!("{:016x}.ir", key))).unwrap(),
+                fs::read(dir.join(format!("{:016x}.ir", !key))).unwrap()
+            );
+        }
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_changed_body_keeps_callers() {
+        let before = keys(PROGRAM);
+        let after = keys(&PROGRAM.replace("return x * x", "return x * x * x"));
+        assert_ne!(before[0], after[0]);
+        assert_eq!(before[1], after[1]);
+        assert_eq!(before[2], after[2]);
+    }
+
+    #[test]
+    fn test_changed_signature_changes_callers() {
+        let before = keys(PROGRAM);
+        let after = keys(&PROGRAM.replace("pure func twice", "func twice"));
+        assert_eq!(before[0], after[0]);
+        assert_ne!(before[1], after[1]);
+        assert_ne!(before[2], after[2]);
+    }
+
+    #[test]
+    fn test_other_compiler_is_missed() {
+        let dir = cache_dir("other-compiler");
+        let cache = IrCache::for_compiler(dir.clone(), "a").unwrap();
+        let same = IrCache::for_compiler(dir.clone(), "a").unwrap();
+        let other = IrCache::for_compiler(dir.clone(), "b").unwrap();
+        let program_ast = parse(PROGRAM);
+        let keys = cache_keys(&cache, PROGRAM);
+        let error_manager = ErrorManager::with_max_count(10);
+        let annotated_ast = StaticAnalyzer::new(error_manager)
+            .infer(program_ast)
+            .unwrap();
+        for (generated, key) in Generator::new(annotated_ast).zip(&keys) {
+            cache.store(*key, &generated).unwrap();
+        }
+        assert_eq!(cache_keys(&same, PROGRAM), keys);
+        for key in cache_keys(&other, PROGRAM) {
+            assert!(!keys.contains(&key));
+            assert!(other.load(key).is_none());
+        }
+        assert!(keys.iter().all(|key| same.load(*key).is_some()));
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_corrupt_entry_is_missed() {
+        let dir = cache_dir("corrupt");
+        let cache = IrCache::new(dir.clone()).unwrap();
+        fs::write(dir.join(format!("{:016x}.ir", 1)), "pulsar ir cache 1\n")
+            .unwrap();
+        assert!(cache.load(1).is_none());
+        assert!(cache.load(2).is_none());
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    /// `ir` with its variables and blocks numbered in the order they appear,
+    /// since IR loaded from the cache is given fresh ones.
+    fn renumber(ir: &str) -> String {
+        let mut numbers = HashMap::new();
+        let mut result = String::new();
+        let mut rest = ir;
+        while let Some(c) = rest.chars().next() {
+            let starts_name = !result.ends_with(char::is_alphanumeric);
+            if let Some(prefix) = ["BB", "i"]
+                .into_iter()
+                .find(|prefix| starts_name && rest.starts_with(prefix))
+            {
+                let digits = rest[prefix.len()..]
+                    .bytes()
+                    .take_while(u8::is_ascii_digit)
+                    .count();
+                if digits > 0 {
+                    let (name, after) = rest.split_at(prefix.len() + digits);
+                    let next = numbers.len();
+                    let number = *numbers.entry(name).or_insert(next);
+                    write!(result, "{}{}", prefix, number).unwrap();
+                    rest = after;
+                    continue;
+                }
+            }
+            result.push(c);
+            rest = &rest[c.len_utf8()..];
+        }
+        result
+    }
+
+    /// The IR of every function in `contents`, one per element, lowered
+    /// through `cache` if given.
+    fn lower(
+        contents: &str, cache: Option<&IrCache>, threads: Option<usize>
+    ) -> Vec<String> {
+        Gen::reset();
+        let error_manager = ErrorManager::with_max_count(10);
+        lower_program(
+            parse(contents),
+            cache,
+            threads,
+            &error_manager,
+            &mut Phases::new()
+        )
+        .unwrap()
+        .iter()
+        .map(|generated| renumber(&generated.to_string()))
+        .collect()
+    }
+
+    #[test]
+    fn test_partial_hit_matches_uncached() {
+        // the changed function sits between cached ones, so loaded and
+        // compiled functions must be put back in program order
+        let changed = PROGRAM.replace("return x + x", "return x + x + x");
+        for threads in [None, Some(1), Some(4)] {
+            let dir = cache_dir("partial-hit");
+            let cache = IrCache::new(dir.clone()).unwrap();
+            lower(PROGRAM, Some(&cache), threads);
+            assert_eq!(fs::read_dir(&dir).unwrap().count(), 3);
+            let cached = lower(&changed, Some(&cache), threads);
+            // only the changed function was compiled and stored again
+            assert_eq!(fs::read_dir(&dir).unwrap().count(), 4);
+            assert_eq!(cached, lower(&changed, None, threads));
+            let _ = fs::remove_dir_all(&dir);
+        }
+    }
+}
@@ -3,9 +3,9 @@ mod tests {
     use insta::assert_snapshot;
     use pulsar_frontend::lexer::Lexer;
     use pulsar_utils::{error::ErrorManager, loc::Source};
-    use std::{cell::RefCell, fs, rc::Rc};
+    use std::{cell::RefCell, fs, rc::Rc, sync::Arc};
 
-    fn read(filename: &str) -> Rc<Source> {
+    fn read(filename: &str) -> Arc<Source> {
         Source::file(
             filename.into(),
             fs::read_to_string(filename)
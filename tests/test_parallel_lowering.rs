@@ -0,0 +1,95 @@
+#[cfg(test)]
+mod tests {
+    use pulsar_frontend::{lexer::Lexer, parser::Parser};
+    use pulsar_ir::lower::lower_program;
+    use pulsar_utils::{
+        error::ErrorManager, id::Gen, loc::Source, stats::Phases
+    };
+
+    /// Functions in four strongly connected components of the call graph,
+    /// `{even, odd}`, `{triple}`, `{sum}` and `{main}`, declared out of
+    /// dependency order.
+    const PROGRAM: &str = "\
+func main(a: Int) -> Int {
+    return even(triple(a)) + sum(a)
+}
+
+func even(x: Int) -> Int {
+    return odd(x) + 1
+}
+
+func triple(x: Int) -> Int {
+    return x * 3
+}
+
+func odd(x: Int) -> Int {
+    return even(x) * 2
+}
+
+func sum(x: Int) -> Int {
+    let values = [x, triple(x), 2, 4]
+    return x + triple(x)
+}
+";
+
+    /// The IR and the diagnostics of lowering `contents` on `threads` threads.
+    fn lower(contents: &str, threads: usize) -> (Option<Vec<String>>, String) {
+        Gen::reset();
+        let error_manager = ErrorManager::with_max_count(10);
+        let source = Source::file("test.plsr".into(), contents.into());
+        let tokens: Vec<_> = Lexer::new(source, error_manager.clone())
+            .into_iter()
+            .collect();
+        let program_ast: Vec<_> = Parser::new(tokens, error_manager.clone())
+            .into_iter()
+            .collect();
+        assert!(!error_manager.borrow().has_errors());
+        let generated = lower_program(
+            program_ast,
+            None,
+            Some(threads),
+            &error_manager,
+            &mut Phases::new()
+        );
+        let mut diagnostics = vec![];
+        error_manager
+            .borrow_mut()
+            .consume_and_write(&mut diagnostics)
+            .unwrap();
+        (
+            generated.map(|generated| {
+                generated.iter().map(|code| code.to_string()).collect()
+            }),
+            String::from_utf8(diagnostics).unwrap()
+        )
+    }
+
+    #[test]
+    fn test_ir_does_not_depend_on_threads() {
+        let (one, _) = lower(PROGRAM, 1);
+        let (four, _) = lower(PROGRAM, 4);
+        let one = one.unwrap();
+        assert_eq!(Some(one.clone()), four);
+        let names = ["main", "even", "triple", "odd", "sum"];
+        assert_eq!(one.len(), names.len());
+        for (code, name) in one.iter().zip(names) {
+            assert!(code.contains(&format!("@native({})(", name)), "{}", code);
+        }
+    }
+
+    #[test]
+    fn test_errors_are_reported_in_program_order() {
+        // one error in the component of `even` and `odd`, and one in `sum`,
+        // which are lowered on different threads
+        let broken = PROGRAM
+            .replace("return even(x) * 2", "return even(y) * 2")
+            .replace("let values = [", "let values: Int = [");
+        let (one, one_diagnostics) = lower(&broken, 1);
+        let (four, four_diagnostics) = lower(&broken, 4);
+        assert!(one.is_none() && four.is_none());
+        assert_eq!(one_diagnostics, four_diagnostics);
+        let odd = one_diagnostics.find("test.plsr:14:17:").unwrap();
+        let sum = one_diagnostics.find("test.plsr:18:9:").unwrap();
+        assert!(odd < sum);
+    }
+}
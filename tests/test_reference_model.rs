@@ -0,0 +1,94 @@
+#[cfg(test)]
+mod tests {
+    use pulsar_backend::{cpp::CppBackend, Output, PulsarBackend};
+    use pulsar_frontend::ty::Type;
+    use pulsar_ir::{
+        control_flow_graph::ControlFlowGraph,
+        generator::GeneratedTopLevel,
+        label::{Label, LabelName, LabelVisibility},
+        operand::Operand,
+        Ir
+    };
+    use pulsar_utils::error::ErrorManager;
+    use std::{env, fs, process};
+
+    /// A `main` returning `Int` whose body is `ir`, after `extend` is applied
+    /// to its CFG.
+    fn main(ir: Ir, extend: fn(&mut ControlFlowGraph)) -> GeneratedTopLevel {
+        let mut cfg = ControlFlowGraph::new();
+        cfg.entry().as_mut().add(ir);
+        extend(&mut cfg);
+        GeneratedTopLevel::Function {
+            label: Label::from(
+                LabelName::from_native("main".into(), &vec![], &Type::Int64),
+                LabelVisibility::Public
+            ),
+            args: vec![],
+            ret: Box::new(Type::Int64),
+            is_pure: false,
+            cfg
+        }
+    }
+
+    /// The reference model emitted for `code` in a file that already held
+    /// one, and what was reported while emitting it.
+    fn emit(name: &str, code: GeneratedTopLevel) -> (Option<String>, String) {
+        let path = env::temp_dir().join(format!(
+            "pulsar-{}-{}.ref.h",
+            name,
+            process::id()
+        ));
+        fs::write(&path, "stale").unwrap();
+        let error_manager = ErrorManager::with_max_count(10);
+        CppBackend::new(error_manager.clone())
+            .emit(&[code], Output::File(path.clone()))
+            .expect("Emitting a reference model should not fail");
+        let model = fs::read_to_string(&path).ok();
+        let _ = fs::remove_file(&path);
+        let mut diagnostics = vec![];
+        error_manager
+            .borrow_mut()
+            .consume_and_write(&mut diagnostics)
+            .unwrap();
+        (model, String::from_utf8(diagnostics).unwrap())
+    }
+
+    #[test]
+    fn test_program_is_modeled() {
+        let (model, diagnostics) = emit(
+            "modeled",
+            main(Ir::Return(Some(Operand::Constant(385))), |_| {})
+        );
+        assert!(model.unwrap().contains("return 385;"));
+        assert_eq!(diagnostics, "");
+    }
+
+    #[test]
+    fn test_multiple_blocks_are_skipped() {
+        let (model, diagnostics) = emit(
+            "blocks",
+            main(Ir::Return(Some(Operand::Constant(385))), |cfg| {
+                cfg.new_block();
+            })
+        );
+        assert_eq!(model, None);
+        assert!(
+            diagnostics.contains("has 2 basic blocks"),
+            "{}",
+            diagnostics
+        );
+    }
+
+    #[test]
+    fn test_undefined_callee_is_skipped() {
+        let callee = LabelName::from_native("f".into(), &vec![], &Type::Unit);
+        let (model, diagnostics) =
+            emit("callee", main(Ir::Call(None, callee, vec![]), |_| {}));
+        assert_eq!(model, None);
+        assert!(
+            diagnostics.contains("is called but not defined"),
+            "{}",
+            diagnostics
+        );
+    }
+}
@@ -0,0 +1,71 @@
+#[cfg(test)]
+mod tests {
+    use pulsar_utils::stats::{Phase, Phases};
+    use std::time::Duration;
+
+    fn phases() -> Phases {
+        let mut phases = Phases::new();
+        phases.push(Phase {
+            name: "infer".into(),
+            time: Duration::from_micros(1500),
+            allocations: 12,
+            peak_heap: 4096,
+            peak_rss: Some(8192)
+        });
+        phases.push(Phase {
+            name: "generate".into(),
+            time: Duration::from_millis(250),
+            allocations: 0,
+            peak_heap: 0,
+            peak_rss: None
+        });
+        phases
+    }
+
+    #[test]
+    fn test_to_text() {
+        assert_eq!(
+            phases().to_text("main.plsr"),
+            concat!(
+                "main.plsr: infer               1.500ms        12 ",
+                "allocations        4096 bytes peak heap  8192 bytes ",
+                "peak rss\n",
+                "main.plsr: generate          250.000ms         0 ",
+                "allocations           0 bytes peak heap     unknown ",
+                "peak rss\n"
+            )
+        );
+        assert_eq!(Phases::new().to_text("main.plsr"), "");
+    }
+
+    #[test]
+    fn test_to_json() {
+        assert_eq!(
+            phases().to_json("dir\\\"main\".plsr"),
+            "{\"file\": \"dir\\\\\\\"main\\\".plsr\", \"phases\": [\
+             {\"name\": \"infer\", \"seconds\": 0.0015, \"allocations\": 12, \
+             \"peak_heap_bytes\": 4096, \"peak_rss_bytes\": 8192}, \
+             {\"name\": \"generate\", \"seconds\": 0.25, \"allocations\": 0, \
+             \"peak_heap_bytes\": 0, \"peak_rss_bytes\": null}]}\n"
+        );
+        assert_eq!(
+            Phases::new().to_json("main.plsr"),
+            "{\"file\": \"main.plsr\", \"phases\": []}\n"
+        );
+    }
+
+    #[test]
+    fn test_only_recording_phases_are_measured() {
+        let mut phases = Phases::new();
+        assert_eq!(phases.measure("parse", || 1), 1);
+        assert_eq!(phases.iter().count(), 0);
+
+        let mut phases = Phases::recording();
+        phases.measure("parse", || ());
+        phases.measure("lower", || ());
+        assert_eq!(
+            phases.iter().map(|phase| &phase.name).collect::<Vec<_>>(),
+            ["parse", "lower"]
+        );
+    }
+}
@@ -3,7 +3,7 @@ mod tests {
     use proptest::prelude::*;
     use pulsar_frontend::token::{Token, TokenType};
     use pulsar_utils::loc::{Loc, Source};
-    use std::rc::Rc;
+    use std::sync::Arc;
 
     fn arb_token_type() -> impl Strategy<Value = TokenType> {
         prop_oneof![
@@ -25,11 +25,11 @@ mod tests {
         ]
     }
 
-    fn arb_source() -> impl Strategy<Value = Rc<Source>> {
+    fn arb_source() -> impl Strategy<Value = Arc<Source>> {
         prop_oneof![
             (any::<String>(), any::<String>())
                 .prop_map(|(name, contents)| { Source::file(name, contents) }),
-            Just(Rc::new(Source::Unknown)),
+            Just(Arc::new(Source::Unknown)),
         ]
     }
 
@@ -65,7 +65,7 @@ mod tests {
         ) {
             assert_eq!(
                 format!("({}, ty = {:?}, loc = {})", value, ty, loc),
-                format!("{:?}",  Token { ty, value, loc })
+                format!("{:?}", Token { ty, value: value.clone().into(), loc })
             );
         }
     }
@@ -5,9 +5,9 @@ mod tests {
         lexer::Lexer, parser::Parser, static_analysis::StaticAnalyzer
     };
     use pulsar_utils::{error::ErrorManager, loc::Source};
-    use std::{cell::RefCell, fs, rc::Rc};
+    use std::{cell::RefCell, fs, rc::Rc, sync::Arc};
 
-    fn read(filename: &str) -> Rc<Source> {
+    fn read(filename: &str) -> Arc<Source> {
         Source::file(
             filename.into(),
             fs::read_to_string(filename)